@@ -0,0 +1,6 @@
+#version 400
+
+//depth only, colour writes are masked
+void main()
+{
+}
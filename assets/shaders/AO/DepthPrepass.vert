@@ -0,0 +1,20 @@
+#version 400
+layout(location = 0) in vec3 pos;
+
+layout (std140) uniform uCameraMat
+{
+	vec3 viewPos;
+	float far;
+	mat4 proj;
+	mat4 view;
+};
+
+uniform mat4 uModel;
+
+//same expression as the G-buffer vertex shaders, GL_EQUAL depth needs bit identical positions
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = proj * view * uModel * vec4(pos, 1.0f);
+}
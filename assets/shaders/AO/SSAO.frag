@@ -1,58 +1,79 @@
-#version 400
+#version 420 core
 
 out float FragAO;
 
 in vec2 vUV;
 in mat4 vViewMatrix;
 
-uniform sampler2D uPosition;
-uniform sampler2D uNormal;
-uniform sampler2D uNoiseTex;
+layout(binding = 0) uniform sampler2D uPosition;
+layout(binding = 1) uniform sampler2D uNormal;
+layout(binding = 2) uniform sampler2D uNoiseTex;
 
 uniform vec3 uSamples[256]; //<--- Max 256
-uniform mat4 uProjection;
-uniform int uKernelSize = 64;
-uniform float uRadius = 2.5f; //0.35f;
-uniform float uBias = 0.025f; //0.0125f; //ensures no self shading artifiacts at tight angless or flat angle
-uniform float uPower = 1.35f; //range 1.5f - 2.0f
-uniform vec2 uNoiseScale = vec2(1920.0f/4.0f, 1080.0f/4.0f); //1920/1080 => 1.777778
+//adaptive mode => sample budget of the tile class being drawn, 0 => full kernel
+uniform int uAdaptiveKernelSize = 0;
 
-uniform bool uWSSample = false;
+//per frame data from the uniform ring (see FrameParamsBlock)
+layout(std140, binding = 1) uniform uFrameParams
+{
+	mat4 projection;
+	vec4 lightDirection;
+	vec4 lightDiffuse;
+	vec4 lightSpecular;
+	vec4 aoParams;		//radius, bias, power, resolution scale
+	vec4 noiseScale;
+	ivec4 aoSettings;	//kernel size, ws sample, sample count (0 => kernel size), blur radius
+	ivec4 lightingFlags;
+	vec4 clusterParams;
+	ivec4 clusterSettings;
+}uFrame;
 
 void main()
 {
+	int kernel_size = uFrame.aoSettings.x;
+	float radius = uFrame.aoParams.x;
+	float bias = uFrame.aoParams.y; //ensures no self shading artifiacts at tight angless or flat angle
+	float power = uFrame.aoParams.z; //range 1.5f - 2.0f
+	bool ws_sample = (uFrame.aoSettings.y != 0);
+	
 	vec3 frag_pos = texture(uPosition, vUV).xyz;
 	vec3 normal = texture(uNormal, vUV).xyz;
 	
-	if(uWSSample)
+	if(ws_sample)
 	{
 		frag_pos = (vViewMatrix * vec4(texture(uPosition, vUV).xyz, 1.0f)).xyz;
 		normal = normalize(mat3(vViewMatrix) * texture(uNormal, vUV).xyz);
 	}
 	
-	vec3 rand_vec = texture(uNoiseTex, vUV * uNoiseScale).xyz;
+	vec3 rand_vec = texture(uNoiseTex, vUV * uFrame.noiseScale.xy).xyz;
 	
 	// Tangent space basis (Grass-Schmidt process) 
 	vec3 tangent = normalize(rand_vec - normal * dot(rand_vec, normal));
 	vec3 bitangent = cross(normal, tangent);
 	mat3 TBN = mat3(tangent, bitangent, normal);
 	
+	//a reduced budget spreads over the whole kernel, every pattern draws its distance per point so any subset keeps the radius range
+	//(i * kernel_size) / budget => even spacing for any budget, power of 2 ratios match the bit reversed halton slots
+	int budget = (uFrame.aoSettings.z > 0) ? min(uFrame.aoSettings.z, kernel_size) : kernel_size;
+	if(uAdaptiveKernelSize > 0)
+		budget = min(uAdaptiveKernelSize, budget);
+	
 	float occlusion = 0.0f;
-	for(int i = 0; i < uKernelSize; ++i)
+	for(int i = 0; i < budget; ++i)
 	{
-		vec3 sample_vec = TBN * uSamples[i];
-		sample_vec = frag_pos + sample_vec * uRadius;
+		vec3 sample_vec = TBN * uSamples[(i * kernel_size) / budget];
+		sample_vec = frag_pos + sample_vec * radius;
 		
-		vec4 offset = uProjection * vec4(sample_vec, 1.0f);
+		vec4 offset = uFrame.projection * vec4(sample_vec, 1.0f);
 		offset.xyz /= offset.w;
 		offset.xyz = offset.xyz * 0.5f + 0.5f;
 	
 		float sample_depth = texture(uPosition, offset.xy).z;
-		if(uWSSample)
+		if(ws_sample)
 			sample_depth = (vViewMatrix * vec4(texture(uPosition, offset.xy).xyz, 1.0f)).z;
-		float range_check = smoothstep(0.0f, 1.0f, uRadius/abs(frag_pos.z - sample_depth));
-		occlusion += (sample_depth >= sample_vec.z + uBias ? 1.0f : 0.0f) * range_check;
+		float range_check = smoothstep(0.0f, 1.0f, radius/abs(frag_pos.z - sample_depth));
+		occlusion += (sample_depth >= sample_vec.z + bias ? 1.0f : 0.0f) * range_check;
 	}
-	occlusion = 1.0f - (occlusion / uKernelSize);
-	FragAO = pow(occlusion, uPower);
+	occlusion = 1.0f - (occlusion / float(budget));
+	FragAO = pow(occlusion, power);
 }
\ No newline at end of file
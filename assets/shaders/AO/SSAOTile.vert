@@ -0,0 +1,49 @@
+#version 430 core
+
+//tile quads for the adaptive SSAO pass, one instance per tile of the drawn budget class
+out vec2 vUV;
+out mat4 vViewMatrix;
+
+layout (std140, binding = 0) uniform uCameraMat
+{
+	vec3 viewPos;
+	float far;
+	mat4 proj;
+	mat4 view;
+};
+
+struct DrawArraysIndirectCommand
+{
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+const int TILE_SIZE = 8;
+const uint BUDGET_CLASS_COUNT = 4u;
+layout(std430, binding = 5) readonly buffer SSAOTileList
+{
+	DrawArraysIndirectCommand commands[BUDGET_CLASS_COUNT];
+	uint tileList[];
+};
+
+//same unit as SSAO.frag, the G-buffer size is the screen size
+layout(binding = 0) uniform sampler2D uPosition;
+uniform int uTileClass;
+
+const vec2 QUAD_CORNERS[6] = vec2[](vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f),
+									vec2(0.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f));
+
+void main()
+{
+	ivec2 screen_size = textureSize(uPosition, 0);
+	ivec2 tile_count = (screen_size + TILE_SIZE - 1) / TILE_SIZE;
+	uint max_tiles = uint(tile_count.x * tile_count.y);
+	uint tile = tileList[uint(uTileClass) * max_tiles + uint(gl_InstanceID)];
+	vec2 tile_xy = vec2(float(tile % uint(tile_count.x)), float(tile / uint(tile_count.x)));
+	
+	vec2 pixel = (tile_xy + QUAD_CORNERS[gl_VertexID]) * float(TILE_SIZE);
+	vUV = min(pixel / vec2(screen_size), vec2(1.0f));
+	vViewMatrix = view;
+	gl_Position = vec4(vUV * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,77 @@
+#version 430 core
+
+//one fragment per 8x8 tile (see SSAOTileClassifier)
+layout(location = 0) out uint oTileClass;
+
+layout(binding = 0) uniform sampler2D uPosition; //view space G-buffer
+layout(binding = 1) uniform sampler2D uNormal;
+
+struct DrawArraysIndirectCommand
+{
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+const int TILE_SIZE = 8;
+const uint BUDGET_CLASS_COUNT = 4u;
+layout(std430, binding = 5) buffer SSAOTileList
+{
+	DrawArraysIndirectCommand commands[BUDGET_CLASS_COUNT];
+	uint tileList[]; //class * max tiles + slot
+};
+
+uniform float uDepthThreshold = 0.05f;	//relative depth std deviation for the full kernel
+uniform float uNormalThreshold = 0.1f;	//1 - |mean normal| for the full kernel
+
+void main()
+{
+	ivec2 tile = ivec2(gl_FragCoord.xy);
+	ivec2 screen_size = textureSize(uPosition, 0);
+	ivec2 tile_count = (screen_size + TILE_SIZE - 1) / TILE_SIZE;
+	ivec2 base = tile * TILE_SIZE;
+	
+	float depth_sum = 0.0f;
+	float depth_sq_sum = 0.0f;
+	vec3 normal_sum = vec3(0.0f);
+	int on_screen = 0;
+	int covered = 0;
+	for(int y = 0; y < TILE_SIZE; ++y)
+	{
+		for(int x = 0; x < TILE_SIZE; ++x)
+		{
+			ivec2 texel = base + ivec2(x, y);
+			if(any(greaterThanEqual(texel, screen_size)))
+				continue;
+			on_screen++;
+			vec3 position = texelFetch(uPosition, texel, 0).xyz;
+			//cleared (sky) texels are in front of the camera
+			if(position.z >= 0.0f)
+				continue;
+			float depth = -position.z;
+			depth_sum += depth;
+			depth_sq_sum += depth * depth;
+			normal_sum += texelFetch(uNormal, texel, 0).xyz;
+			covered++;
+		}
+	}
+	
+	//empty tiles keep the minimum, tiles with a silhouette against the sky get everything
+	uint tile_class = 0u;
+	if(covered > 0)
+	{
+		float mean = depth_sum / float(covered);
+		float variance = max(depth_sq_sum / float(covered) - mean * mean, 0.0f);
+		float depth_score = (sqrt(variance) / mean) / uDepthThreshold;
+		float normal_score = (1.0f - length(normal_sum / float(covered))) / uNormalThreshold;
+		float score = max(depth_score, normal_score);
+		if(covered < on_screen)
+			score = 1.0f;
+		tile_class = (score >= 1.0f) ? 3u : (score >= 0.5f) ? 2u : (score >= 0.25f) ? 1u : 0u;
+	}
+	
+	oTileClass = tile_class;
+	uint max_tiles = uint(tile_count.x * tile_count.y);
+	uint slot = atomicAdd(commands[tile_class].instanceCount, 1u);
+	tileList[tile_class * max_tiles + slot] = uint(tile.y * tile_count.x + tile.x);
+}
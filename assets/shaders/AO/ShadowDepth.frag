@@ -0,0 +1,6 @@
+#version 400
+
+//depth only, nothing to write
+void main()
+{
+}
@@ -0,0 +1,10 @@
+#version 400
+layout(location = 0) in vec3 pos;
+
+uniform mat4 uModel;
+uniform mat4 uLightSpaceMat;
+
+void main()
+{
+	gl_Position = uLightSpaceMat * uModel * vec4(pos, 1.0f);
+}
@@ -1,4 +1,4 @@
-#version 420 core
+#version 430 core
 
 out vec4 FragColour;
 
@@ -26,26 +26,85 @@ layout(binding = 3) uniform sampler2D uMaterialData; //includes {Ambient colour
 layout(binding = 4) uniform sampler2D uShadowMap;
 
 layout(binding = 5) uniform sampler2D uSSAO;
+layout(binding = 6) uniform usampler2D uSSAOTileClass; //adaptive SSAO budget class per 8x8 tile
 
 
-uniform DirectionalLight uDirectionalLight;
+//per frame data from the uniform ring (see FrameParamsBlock)
+layout(std140, binding = 1) uniform uFrameParams
+{
+	mat4 projection;
+	vec4 lightDirection; //xyz, w => enable
+	vec4 lightDiffuse;
+	vec4 lightSpecular;
+	vec4 aoParams;
+	vec4 noiseScale;
+	ivec4 aoSettings;	 //kernel size, ws sample, sample count, blur radius
+	ivec4 lightingFlags; //enable ao, blur ao, only ao render, SSAO sample heatmap
+	vec4 clusterParams;	 //near, log(far/near), local light count
+	ivec4 clusterSettings; //grid x, y, z, enable
+}uFrame;
+
+//clustered local lights (see ClusteredLightCuller), all view space
+struct LocalLight
+{
+	vec4 positionRange;
+	vec4 colourIntensity;
+	vec4 directionType;	//xyz, type (0 point, 1 spot)
+	vec4 spotCone;		//cos inner, cos outer
+};
+layout(std430, binding = 0) readonly buffer LocalLightBuffer { LocalLight localLights[]; };
+layout(std430, binding = 1) readonly buffer ClusterGridBuffer { uvec2 clusterGrid[]; }; //offset, count
+layout(std430, binding = 2) readonly buffer ClusterIndexBuffer { uint clusterLightIndices[]; };
+const float LOCAL_LIGHT_AMBIENT = 0.1f;
+
+//directional light cascades, 2x2 in the uShadowMap atlas (see CascadedShadowMap)
+const int SHADOW_CASCADE_COUNT = 4;
+layout(std140, binding = 2) uniform uShadowParams
+{
+	mat4 lightViewProj[SHADOW_CASCADE_COUNT]; //world => atlas uv & depth
+	mat4 invView;
+	vec4 splitDepths;	//view space far of each cascade
+	vec4 params;		//depth bias, slope bias, unused, enable
+}uShadow;
+
 uniform bool uPhongRendering;
 uniform bool uEnableShadow = true;
-uniform bool uEnableAO = true;
-uniform bool uBlurAO = true;
 
-uniform bool uOnlyAORender = false;
-uniform bool uWSSample = false;
+//unpacked from uFrameParams in main
+DirectionalLight dir_light;
+bool enable_ao = true;
+bool blur_ao = true;
+bool only_ao_render = false;
+bool ws_sample = false;
 
 //Functions
 vec3 ComputeLightingVS();
 vec3 ComputeLightingWS();
+vec3 ComputeLocalLighting(vec3 frag_pos_vs, vec3 normal_vs, vec3 albedo, vec3 ambient_colour, float shinness, float ao);
+float ComputeShadow(vec3 frag_pos_ws, float view_depth, float n_dot_l);
+float SampleSSAO(vec2 texel_offset);
 float OcclusionBoxBlur();
 float OcclusionGaussianBlur();
 
 void main()
 {
-	vec3 compute_lighting = (uWSSample) ? ComputeLightingWS() : ComputeLightingVS();
+	dir_light.direction = uFrame.lightDirection.xyz;
+	dir_light.enable = (uFrame.lightDirection.w > 0.5f);
+	dir_light.diffuse = uFrame.lightDiffuse.rgb;
+	dir_light.specular = uFrame.lightSpecular.rgb;
+	enable_ao = (uFrame.lightingFlags.x != 0);
+	blur_ao = (uFrame.lightingFlags.y != 0);
+	only_ao_render = (uFrame.lightingFlags.z != 0);
+	ws_sample = (uFrame.aoSettings.y != 0);
+
+	vec3 compute_lighting = (ws_sample) ? ComputeLightingWS() : ComputeLightingVS();
+	if(uFrame.lightingFlags.w != 0)
+	{
+		//blue (few samples) => red (full kernel)
+		const vec3 heat[4] = vec3[](vec3(0.1f, 0.2f, 1.0f), vec3(0.1f, 1.0f, 0.3f), vec3(1.0f, 0.9f, 0.1f), vec3(1.0f, 0.1f, 0.1f));
+		uint tile_class = min(texelFetch(uSSAOTileClass, ivec2(gl_FragCoord.xy) / 8, 0).r, 3u);
+		compute_lighting = mix(compute_lighting, heat[tile_class], 0.5f);
+	}
 	FragColour = vec4(compute_lighting, 1.0f);
 }
 
@@ -60,38 +119,41 @@ vec3 ComputeLightingVS()
 	float shinness = texture(uMaterialData, vUV).a;
 	
 	float ao = 1.0f;
-	if(uEnableAO&&uBlurAO)
+	if(enable_ao&&blur_ao)
 	{
 		ao = OcclusionBoxBlur();
 		//ao = OcclusionGaussianBlur();
 	}
-	else if(uEnableAO&&!uBlurAO)
-		ao = texture(uSSAO, vUV).r;
+	else if(enable_ao&&!blur_ao)
+		ao = SampleSSAO(vec2(0.0f));
 	
 	
 	vec3 lighting = vec3(0.0f);
-	if(uDirectionalLight.enable)
+	if(dir_light.enable)
 	{
 		//frag ambient
 		vec3 ambient = 0.7f * ambient_colour * ao;
-		//ambient *= uDirectionalLight.ambient;
+		//ambient *= dir_light.ambient;
 		
-		vec3 light_dir_VS =  normalize(mat3(vViewMatrix) * uDirectionalLight.direction);
+		vec3 light_dir_VS =  normalize(mat3(vViewMatrix) * dir_light.direction);
 		
 		//frag diffuse
 		float factor = max(dot(normal, light_dir_VS), 0.0f);
-		vec3 diffuse = factor * uDirectionalLight.diffuse * albedo;
+		vec3 diffuse = factor * dir_light.diffuse * albedo;
 	
 		//frag specular 
 		vec3 view_dir = normalize(-frag_pos);
 		vec3 H = normalize(light_dir_VS + view_dir);
 		float spec = pow(max(dot(normal, H), 0.0f), shinness);
-		vec3 compute_specular = uDirectionalLight.specular * spec;// * specular;
+		vec3 compute_specular = dir_light.specular * spec;// * specular;
 	
-		lighting = ambient + diffuse + compute_specular;
+		vec3 frag_pos_ws = (uShadow.invView * vec4(frag_pos, 1.0f)).xyz;
+		float shadow = ComputeShadow(frag_pos_ws, -frag_pos.z, factor);
+		lighting = ambient + (1.0f - shadow) * (diffuse + compute_specular);
 	}
+	lighting += ComputeLocalLighting(frag_pos, normal, albedo, ambient_colour, shinness, ao);
 		
-	if(uOnlyAORender)
+	if(only_ao_render)
 		lighting = vec3(ao);
 		
 	return lighting;
@@ -108,72 +170,155 @@ vec3 ComputeLightingWS()
 	float shinness = texture(uMaterialData, vUV).a;
 	
 	float ao = 1.0f;
-	if(uEnableAO&&uBlurAO)
+	if(enable_ao&&blur_ao)
 	{
 		ao = OcclusionBoxBlur();
 		//ao = OcclusionGaussianBlur();
 	}
-	else if(uEnableAO&&!uBlurAO)
-		ao = texture(uSSAO, vUV).r;
+	else if(enable_ao&&!blur_ao)
+		ao = SampleSSAO(vec2(0.0f));
 	
 	
 	vec3 lighting = vec3(0.0f);
-	if(uDirectionalLight.enable)
+	if(dir_light.enable)
 	{
 		//frag ambient
 		vec3 ambient = 0.7f * ambient_colour * ao;
-		//ambient *= uDirectionalLight.ambient;
+		//ambient *= dir_light.ambient;
 		
-		vec3 light_dir_VS =  normalize(uDirectionalLight.direction);
+		vec3 light_dir_VS =  normalize(dir_light.direction);
 		
 		//frag diffuse
 		float factor = max(dot(normal, light_dir_VS), 0.0f);
-		vec3 diffuse = factor * uDirectionalLight.diffuse * albedo;
+		vec3 diffuse = factor * dir_light.diffuse * albedo;
 	
 		//frag specular 
 		vec3 view_dir = normalize(vViewPos - frag_pos);
 		vec3 H = normalize(light_dir_VS + view_dir);
 		float spec = pow(max(dot(normal, H), 0.0f), shinness);
-		vec3 compute_specular = uDirectionalLight.specular * spec;// * specular;
+		vec3 compute_specular = dir_light.specular * spec;// * specular;
 	
-		lighting = ambient + diffuse + compute_specular;
+		float shadow = ComputeShadow(frag_pos, -(vViewMatrix * vec4(frag_pos, 1.0f)).z, factor);
+		lighting = ambient + (1.0f - shadow) * (diffuse + compute_specular);
 	}
+	vec3 frag_pos_vs = (vViewMatrix * vec4(frag_pos, 1.0f)).xyz;
+	vec3 normal_vs = normalize(mat3(vViewMatrix) * normal);
+	lighting += ComputeLocalLighting(frag_pos_vs, normal_vs, albedo, ambient_colour, shinness, ao);
 		
-	if(uOnlyAORender)
+	if(only_ao_render)
 		lighting = vec3(ao);
 		
 	return lighting;
 }
 
 
-float OcclusionBoxBlur()
+vec3 ComputeLocalLighting(vec3 frag_pos_vs, vec3 normal_vs, vec3 albedo, vec3 ambient_colour, float shinness, float ao)
 {
+	float depth = -frag_pos_vs.z;
+	if(uFrame.clusterSettings.w == 0 || depth <= uFrame.clusterParams.x)
+		return vec3(0.0f);
+	
+	//froxel lookup, exponential depth slices
+	ivec3 grid = uFrame.clusterSettings.xyz;
+	ivec2 tile = clamp(ivec2(vUV * vec2(grid.xy)), ivec2(0), grid.xy - 1);
+	int slice = clamp(int(log(depth / uFrame.clusterParams.x) / uFrame.clusterParams.y * float(grid.z)), 0, grid.z - 1);
+	uvec2 cluster = clusterGrid[(slice * grid.y + tile.y) * grid.x + tile.x];
+	
+	vec3 view_dir = normalize(-frag_pos_vs);
+	vec3 direct = vec3(0.0f);
+	vec3 indirect = vec3(0.0f);
+	for(uint i = 0u; i < cluster.y; ++i)
+	{
+		LocalLight light = localLights[clusterLightIndices[cluster.x + i]];
+		vec3 to_light = light.positionRange.xyz - frag_pos_vs;
+		float dist = length(to_light);
+		float range = light.positionRange.w;
+		if(dist >= range)
+			continue;
+		vec3 light_dir = to_light / dist;
+		
+		//windowed inverse square, reaches 0 at range
+		float window = clamp(1.0f - pow(dist / range, 4.0f), 0.0f, 1.0f);
+		float attenuation = (window * window) / (dist * dist + 1.0f);
+		if(light.directionType.w > 0.5f)
+			attenuation *= smoothstep(light.spotCone.y, light.spotCone.x, dot(-light_dir, light.directionType.xyz));
+		vec3 radiance = light.colourIntensity.rgb * light.colourIntensity.a * attenuation;
+		
+		float factor = max(dot(normal_vs, light_dir), 0.0f);
+		vec3 H = normalize(light_dir + view_dir);
+		float spec = pow(max(dot(normal_vs, H), 0.0f), shinness);
+		direct += radiance * (factor * albedo + spec);
+		indirect += radiance * ambient_colour;
+	}
+	//AO only modulates the indirect term
+	return direct + LOCAL_LIGHT_AMBIENT * indirect * ao;
+}
+
+
+float ComputeShadow(vec3 frag_pos_ws, float view_depth, float n_dot_l)
+{
+	if(!uEnableShadow || uShadow.params.w < 0.5f || view_depth > uShadow.splitDepths[SHADOW_CASCADE_COUNT - 1])
+		return 0.0f;
+	
+	int cascade = 0;
+	while(cascade < SHADOW_CASCADE_COUNT - 1 && view_depth > uShadow.splitDepths[cascade])
+		cascade++;
+	
+	vec3 coord = (uShadow.lightViewProj[cascade] * vec4(frag_pos_ws, 1.0f)).xyz;
+	float bias = max(uShadow.params.y * (1.0f - n_dot_l), uShadow.params.x);
+	
+	//3x3 PCF, kept inside the cascade tile
+	vec2 texel_size = 1.0f / vec2(textureSize(uShadowMap, 0));
+	vec2 tile_min = vec2(float(cascade % 2), float(cascade / 2)) * 0.5f + texel_size;
+	vec2 tile_max = tile_min + vec2(0.5f) - 2.0f * texel_size;
+	float shadow = 0.0f;
+	for(int x = -1; x <= 1; ++x)
+	{
+		for(int y = -1; y <= 1; ++y)
+		{
+			vec2 uv = clamp(coord.xy + vec2(float(x), float(y)) * texel_size, tile_min, tile_max);
+			shadow += (coord.z - bias > texture(uShadowMap, uv).r) ? 1.0f : 0.0f;
+		}
+	}
+	return shadow / 9.0f;
+}
+
+
+//SSAO is only rendered into the lower left resolution scale sub rect of its target
+float SampleSSAO(vec2 texel_offset)
+{
+	float scale = uFrame.aoParams.w;
 	vec2 texelSize = 1.0f / vec2(textureSize(uSSAO, 0));
+	vec2 uv = vUV * scale + texel_offset * texelSize;
+	return texture(uSSAO, min(uv, vec2(scale) - 0.5f * texelSize)).r;
+}
+
+//2r x 2r box, r = 2 => 4x4 which cancels the default 4x4 noise tile
+float OcclusionBoxBlur()
+{
+	int radius = uFrame.aoSettings.w;
+	if(radius <= 0)
+		return SampleSSAO(vec2(0.0f));
 	float ambient_occulsion = 0.0f;
-	for(int x = -2; x < 2; ++x)
+	for(int x = -radius; x < radius; ++x)
 	{
-		for(int y = -2; y < 2; ++y)
-			{
-				vec2 offset = vec2(float(x), float(y)) * texelSize;
-				ambient_occulsion += texture(uSSAO, vUV + offset).r;
-			}
+		for(int y = -radius; y < radius; ++y)
+			ambient_occulsion += SampleSSAO(vec2(float(x), float(y)));
 	}		
-	return ambient_occulsion / 16.0f;
+	return ambient_occulsion / float(4 * radius * radius);
 }
 
 
 float OcclusionGaussianBlur()
 {
-	vec2 texelSize = 1.0f / vec2(textureSize(uSSAO, 0));
 	float weights[3] = float[](0.27901f, 0.44198f, 0.27901f);
 	float occlusion = 0.0f;
 	for(int x = -1; x <= 1; ++x)
 	{
 		for(int y = -1; y <= 1; ++y)
 		{
-			vec2 offset = vec2(float(x), float(y)) * texelSize;
 			float weight = weights[abs(x)] * weights[abs(y)];
-			occlusion += texture(uSSAO, vUV + offset).r * weight;
+			occlusion += SampleSSAO(vec2(float(x), float(y))) * weight;
 		}
 	}
 	return occlusion;
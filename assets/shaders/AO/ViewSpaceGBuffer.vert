@@ -31,6 +31,9 @@ out VS_OUT
 uniform mat4 uModel;
 uniform mat4 uLightSpaceMat;
 
+//matches DepthPrepass.vert for the GL_EQUAL G-buffer pass
+invariant gl_Position;
+
 void main()
 {
 	vec4 world_pos = uModel * vec4(pos, 1.0f);
@@ -46,6 +49,6 @@ void main()
 	vs_out.normal = mat3(transpose(inverse(view * uModel))) * normalize(nor);
 	vs_out.fragPosLightSpace = uLightSpaceMat * uModel * vec4(pos, 1.0f);
 	
-	gl_Position = proj * view * world_pos;
+	gl_Position = proj * view * uModel * vec4(pos, 1.0f);
 	
 } 
\ No newline at end of file
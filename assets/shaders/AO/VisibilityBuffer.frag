@@ -0,0 +1,10 @@
+#version 400
+
+layout(location = 0) out uvec2 oVisibility; //instance id + 1 (sub mesh in the top bits), triangle id
+
+uniform int uInstanceID;
+
+void main()
+{
+	oVisibility = uvec2(uint(uInstanceID) + 1u, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,19 @@
+#version 400
+layout(location = 0) in vec3 pos;
+
+layout (std140) uniform uCameraMat
+{
+	vec3 viewPos;
+	float far;
+	mat4 proj;
+	mat4 view;
+};
+
+uniform mat4 uModel;
+
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = proj * view * uModel * vec4(pos, 1.0f);
+}
@@ -0,0 +1,95 @@
+#version 430 core
+
+layout(location = 0) out vec3 oPosition;
+layout(location = 1) out vec3 oNormals;
+layout(location = 2) out vec4 oAlbedoSpec;    //inc diffuse.rgb, specular
+layout(location = 3) out vec4 oMaterialData; //inc ambient.rgb, shiness
+
+in vec2 vUV;
+
+layout (std140, binding = 0) uniform uCameraMat
+{
+	vec3 viewPos;
+	float far;
+	mat4 proj;
+	mat4 view;
+};
+
+layout(binding = 0) uniform usampler2D uVisibility;
+layout(binding = 1) uniform sampler2D uVisibilityDepth;
+
+//see GPUVisMaterial
+struct MaterialData
+{
+	vec4 diffuse;
+	vec4 ambient;
+	vec4 specularShininess;
+};
+layout(std430, binding = 3) readonly buffer MaterialBuffer { MaterialData materials[]; };
+layout(std430, binding = 4) readonly buffer InstanceMaterialBuffer { uint instanceMaterials[]; };
+
+const uint SUBMESH_BITS = 8u;
+const uint INSTANCE_MASK = (1u << (32u - SUBMESH_BITS)) - 1u;
+
+//resolve into the world space G-buffer layout instead of view space
+uniform bool uWorldSpace = false;
+
+ivec2 screen_size;
+
+vec3 ViewPosition(ivec2 texel)
+{
+	//glm perspective => ndc z = (proj[2][2] * z + proj[3][2]) / -z
+	float ndc_z = texelFetch(uVisibilityDepth, texel, 0).r * 2.0f - 1.0f;
+	vec2 ndc = (vec2(texel) + 0.5f) / vec2(screen_size) * 2.0f - 1.0f;
+	float z = -proj[3][2] / (ndc_z + proj[2][2]);
+	return vec3(ndc.x * -z / proj[0][0], ndc.y * -z / proj[1][1], z);
+}
+
+//edge vector along one axis, prefers a neighbour on the same triangle (exact plane)
+vec3 EdgeVector(ivec2 texel, ivec2 axis, uvec2 id, vec3 centre)
+{
+	ivec2 forward = clamp(texel + axis, ivec2(0), screen_size - 1);
+	ivec2 back = clamp(texel - axis, ivec2(0), screen_size - 1);
+	if(texelFetch(uVisibility, forward, 0).xy == id && forward != texel)
+		return ViewPosition(forward) - centre;
+	if(texelFetch(uVisibility, back, 0).xy == id && back != texel)
+		return centre - ViewPosition(back);
+	
+	//sub pixel triangle, closest depth wins
+	vec3 to_forward = ViewPosition(forward) - centre;
+	vec3 to_back = centre - ViewPosition(back);
+	return (abs(to_forward.z) < abs(to_back.z)) ? to_forward : to_back;
+}
+
+void main()
+{
+	screen_size = textureSize(uVisibility, 0);
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	uvec2 id = texelFetch(uVisibility, texel, 0).xy;
+	//empty => keep the G-buffer clear colour
+	if(id.x == 0u)
+		discard;
+	
+	vec3 position = ViewPosition(texel);
+	//flat face normal, vertex normals are not reachable from here => approximation of the interpolated DIRECT normals
+	vec3 normal = normalize(cross(EdgeVector(texel, ivec2(1, 0), id, position), EdgeVector(texel, ivec2(0, 1), id, position)));
+	if(dot(normal, -position) < 0.0f)
+		normal = -normal;
+	
+	MaterialData material = materials[instanceMaterials[(id.x - 1u) & INSTANCE_MASK]];
+	oMaterialData = vec4(material.ambient.rgb, material.specularShininess.w);
+	if(uWorldSpace)
+	{
+		//rigid view => inverse rotation is the transpose
+		mat3 inv_rot = transpose(mat3(view));
+		oPosition = inv_rot * (position - view[3].xyz);
+		oNormals = inv_rot * normal;
+		oAlbedoSpec = vec4(material.diffuse.rgb, length(material.specularShininess.rgb));
+	}
+	else
+	{
+		oPosition = position;
+		oNormals = normal;
+		oAlbedoSpec = vec4(material.diffuse.rgb, material.specularShininess.r);
+	}
+}
@@ -23,6 +23,9 @@ out VS_OUT
 
 uniform mat4 uModel;
 
+//matches DepthPrepass.vert for the GL_EQUAL G-buffer pass
+invariant gl_Position;
+
 void main()
 {
 	gl_Position = proj * view * uModel * vec4(pos, 1.0f); //MVP
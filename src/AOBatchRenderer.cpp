@@ -0,0 +1,244 @@
+#include "AOBatchRenderer.h"
+
+#include "pregl/Core/Log.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+bool LoadAOBatchPoses(const char* file_path, std::vector<AOBatchPose>& poses)
+{
+	std::ifstream file(file_path);
+	if (!file.is_open())
+	{
+		printf("[AO Batch] Failed to open pose file: %s\n", file_path);
+		return false;
+	}
+
+	std::string line;
+	uint32_t line_num = 0;
+	while (std::getline(file, line))
+	{
+		line_num++;
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream stream(line);
+		AOBatchPose pose;
+		if (!(stream >> pose.position.x >> pose.position.y >> pose.position.z >> pose.target.x >> pose.target.y >> pose.target.z))
+		{
+			printf("[AO Batch] Skipping malformed pose at line %u: %s\n", line_num, line.c_str());
+			continue;
+		}
+		poses.push_back(pose);
+	}
+	return !poses.empty();
+}
+
+void GenerateOrbitAOBatchPoses(uint32_t count, const glm::vec3& center, float radius, float height, std::vector<AOBatchPose>& poses)
+{
+	poses.reserve(poses.size() + count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float angle = glm::radians(360.0f) * static_cast<float>(i) / static_cast<float>(count);
+		glm::vec3 position = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+		poses.push_back({ position, center });
+	}
+}
+
+
+//////////////////////////////////////////////////
+// AO BATCH READBACK
+//////////////////////////////////////////////////
+namespace
+{
+	//binary PGM, GL rows are bottom up => write flipped
+	bool WritePGM(const std::string& file_path, const uint8_t* pixels, uint32_t width, uint32_t height)
+	{
+		FILE* file = fopen(file_path.c_str(), "wb");
+		if (!file)
+			return false;
+		fprintf(file, "P5\n%u %u\n255\n", width, height);
+		for (uint32_t y = 0; y < height; y++)
+			fwrite(pixels + static_cast<size_t>(height - 1 - y) * width, 1, width, file);
+		fclose(file);
+		return true;
+	}
+}
+
+AOBatchReadback::AOBatchReadback(uint32_t ring_depth, uint32_t writer_threads)
+	: mRingDepth((ring_depth > 0) ? ring_depth : 1), mWriterPool(writer_threads)
+{
+	mSlots.resize(mRingDepth);
+}
+
+AOBatchReadback::~AOBatchReadback()
+{
+	Finish();
+	Release();
+}
+
+void AOBatchReadback::Begin(uint32_t width, uint32_t height, const std::string& output_dir)
+{
+	Finish();
+	Release();
+
+	mWidth = width;
+	mHeight = height;
+	mOutputDir = output_dir;
+	mReadbackWaitSeconds = 0.0;
+	mFailedReadbacks = 0;
+	if (!mOutputDir.empty())
+		std::filesystem::create_directories(mOutputDir);
+
+	const GLsizeiptr image_size = static_cast<GLsizeiptr>(mWidth) * mHeight;
+	for (auto& slot : mSlots)
+	{
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, image_size, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	//ring + a couple queued per writer
+	size_t image_buffer_count = mRingDepth + 2 * mWriterPool.GetThreadCount();
+	mImageBuffers.resize(image_buffer_count);
+	mFreeImageBuffers.clear();
+	for (size_t i = 0; i < image_buffer_count; i++)
+	{
+		mImageBuffers[i].resize(static_cast<size_t>(image_size));
+		mFreeImageBuffers.push_back(i);
+	}
+}
+
+void AOBatchReadback::Capture(uint32_t view_idx)
+{
+	Slot& slot = mSlots[view_idx % mRingDepth];
+	//only happens when views are captured out of order
+	if (slot.bInFlight)
+		Retire(slot);
+
+	//tightly packed rows, caller's pack state is put back
+	GLint prev_alignment = 4;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &prev_alignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	glReadPixels(0, 0, mWidth, mHeight, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, prev_alignment);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.viewIdx = view_idx;
+	slot.bInFlight = true;
+
+	const uint32_t lag = mRingDepth - 1;
+	if (view_idx >= lag)
+	{
+		Slot& oldest = mSlots[(view_idx - lag) % mRingDepth];
+		if (oldest.bInFlight)
+			Retire(oldest);
+	}
+}
+
+void AOBatchReadback::Finish()
+{
+	//retire in view order
+	while (true)
+	{
+		Slot* oldest = nullptr;
+		for (auto& slot : mSlots)
+		{
+			if (slot.bInFlight && (!oldest || slot.viewIdx < oldest->viewIdx))
+				oldest = &slot;
+		}
+		if (!oldest)
+			break;
+		Retire(*oldest);
+	}
+	mWriterPool.WaitIdle();
+}
+
+void AOBatchReadback::Retire(Slot& slot)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//flush on the first wait so the fence is guaranteed to signal
+	GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (glClientWaitSync(slot.fence, wait_flags, 1000000) == GL_TIMEOUT_EXPIRED)
+		wait_flags = 0;
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+	slot.bInFlight = false;
+
+	const size_t image_size = static_cast<size_t>(mWidth) * mHeight;
+	size_t buffer_idx = AcquireImageBuffer();
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image_size, GL_MAP_READ_BIT);
+	if (mapped)
+	{
+		memcpy(mImageBuffers[buffer_idx].data(), mapped, image_size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	mReadbackWaitSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	//image buffer still holds an older view, never write it under this name
+	if (!mapped)
+	{
+		printf("[AO Batch] Failed to map readback of view %u, skipped\n", slot.viewIdx);
+		mFailedReadbacks++;
+		ReleaseImageBuffer(buffer_idx);
+		return;
+	}
+	if (mOutputDir.empty())
+	{
+		ReleaseImageBuffer(buffer_idx);
+		return;
+	}
+
+	char file_name[32];
+	snprintf(file_name, sizeof(file_name), "/ao_%05u.pgm", slot.viewIdx);
+	std::string file_path = mOutputDir + file_name;
+	uint32_t width = mWidth;
+	uint32_t height = mHeight;
+	mWriterPool.Enqueue([this, buffer_idx, file_path, width, height]()
+		{
+			if (!WritePGM(file_path, mImageBuffers[buffer_idx].data(), width, height))
+				printf("[AO Batch] Failed to write %s\n", file_path.c_str());
+			ReleaseImageBuffer(buffer_idx);
+		});
+}
+
+size_t AOBatchReadback::AcquireImageBuffer()
+{
+	std::unique_lock<std::mutex> lock(mImageBufferMutex);
+	mImageBufferCV.wait(lock, [this]() { return !mFreeImageBuffers.empty(); });
+	size_t idx = mFreeImageBuffers.back();
+	mFreeImageBuffers.pop_back();
+	return idx;
+}
+
+void AOBatchReadback::ReleaseImageBuffer(size_t idx)
+{
+	{
+		std::lock_guard<std::mutex> lock(mImageBufferMutex);
+		mFreeImageBuffers.push_back(idx);
+	}
+	mImageBufferCV.notify_one();
+}
+
+void AOBatchReadback::Release()
+{
+	for (auto& slot : mSlots)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		if (slot.pbo)
+			glDeleteBuffers(1, &slot.pbo);
+		slot = Slot();
+	}
+}
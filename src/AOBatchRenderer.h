@@ -0,0 +1,90 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "ThreadPool.h"
+
+//////////////////////////////////////////////////
+// AO BATCH RENDERING
+//////////////////////////////////////////////////
+struct AOBatchPose
+{
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+//one pose per line => "px py pz tx ty tz", '#' comments
+bool LoadAOBatchPoses(const char* file_path, std::vector<AOBatchPose>& poses);
+//ring around center, used by the benchmark
+void GenerateOrbitAOBatchPoses(uint32_t count, const glm::vec3& center, float radius, float height, std::vector<AOBatchPose>& poses);
+
+struct AOBatchStats
+{
+	uint32_t viewCount = 0;
+	double totalSeconds = 0.0;
+	double renderSeconds = 0.0;		 //CPU submit of G-buffer, SSAO & lighting
+	double readbackWaitSeconds = 0.0; //fence wait + map/copy on the main thread
+	uint32_t failedReadbacks = 0;	 //PBO map failed, view not written
+	double ViewsPerSecond() const { return (totalSeconds > 0.0) ? viewCount / totalSeconds : 0.0; }
+};
+
+//Pipelined readback of a single channel (GL_RED, 8 bit) render target.
+//Capture(N) issues an async glReadPixels into PBO slot N % ring depth & fences it,
+//view N - (ring depth - 1) is retired (mapped & handed to the writer pool) right after.
+//A ring depth of 3 keeps the readback of view N in flight while N + 1 & N + 2 are rendered,
+//ring depth 1 degrades to a synchronous readback.
+class AOBatchReadback
+{
+public:
+	AOBatchReadback(uint32_t ring_depth = 3, uint32_t writer_threads = 0);
+	~AOBatchReadback();
+
+	AOBatchReadback(const AOBatchReadback&) = delete;
+	AOBatchReadback& operator=(const AOBatchReadback&) = delete;
+
+	//empty output dir => read back only, nothing gets encoded/written
+	void Begin(uint32_t width, uint32_t height, const std::string& output_dir);
+	//reads the currently bound read framebuffer (colour attachment 0)
+	void Capture(uint32_t view_idx);
+	//retires every in flight slot & waits on the writers
+	void Finish();
+
+	double GetReadbackWaitSeconds() const { return mReadbackWaitSeconds; }
+	uint32_t GetFailedReadbackCount() const { return mFailedReadbacks; }
+
+private:
+	struct Slot
+	{
+		GLuint pbo = 0;
+		GLsync fence = nullptr;
+		uint32_t viewIdx = 0;
+		bool bInFlight = false;
+	};
+
+	void Retire(Slot& slot);
+	size_t AcquireImageBuffer();
+	void ReleaseImageBuffer(size_t idx);
+	void Release();
+
+	uint32_t mRingDepth = 3;
+	std::vector<Slot> mSlots;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	std::string mOutputDir;
+	double mReadbackWaitSeconds = 0.0;
+	uint32_t mFailedReadbacks = 0;
+
+	//CPU image copies handed to writers, fixed count => backpressure when writers fall behind
+	std::vector<std::vector<uint8_t>> mImageBuffers;
+	std::vector<size_t> mFreeImageBuffers;
+	std::mutex mImageBufferMutex;
+	std::condition_variable mImageBufferCV;
+
+	ThreadPool mWriterPool;
+};
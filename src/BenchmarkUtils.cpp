@@ -0,0 +1,65 @@
+#include "BenchmarkUtils.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+namespace Benchmark
+{
+	size_t GetProcessResidentBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return static_cast<size_t>(counters.WorkingSetSize);
+		return 0;
+#else
+		FILE* file = fopen("/proc/self/statm", "r");
+		if (!file)
+			return 0;
+		unsigned long total_pages = 0, resident_pages = 0;
+		int read = fscanf(file, "%lu %lu", &total_pages, &resident_pages);
+		fclose(file);
+		if (read != 2)
+			return 0;
+		return static_cast<size_t>(resident_pages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+	double TimingStats::Mean() const
+	{
+		if (mSamples.empty())
+			return 0.0;
+		return std::accumulate(mSamples.begin(), mSamples.end(), 0.0) / static_cast<double>(mSamples.size());
+	}
+
+	double TimingStats::Min() const
+	{
+		return mSamples.empty() ? 0.0 : *std::min_element(mSamples.begin(), mSamples.end());
+	}
+
+	double TimingStats::Max() const
+	{
+		return mSamples.empty() ? 0.0 : *std::max_element(mSamples.begin(), mSamples.end());
+	}
+
+	double TimingStats::Percentile(double p) const
+	{
+		if (mSamples.empty())
+			return 0.0;
+		std::vector<double> sorted = mSamples;
+		std::sort(sorted.begin(), sorted.end());
+		size_t idx = static_cast<size_t>((std::clamp(p, 0.0, 100.0) / 100.0) * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[idx];
+	}
+}
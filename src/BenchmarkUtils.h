@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+//////////////////////////////////////////////////
+// BENCHMARK UTILS
+//////////////////////////////////////////////////
+namespace Benchmark
+{
+	//resident set size of this process, 0 when unsupported
+	size_t GetProcessResidentBytes();
+
+	//collects samples (ms) for one measured case
+	class TimingStats
+	{
+	public:
+		void Reserve(size_t count) { mSamples.reserve(count); }
+		void Add(double ms) { mSamples.push_back(ms); }
+		void Clear() { mSamples.clear(); }
+
+		size_t Count() const { return mSamples.size(); }
+		double Mean() const;
+		double Min() const;
+		double Max() const;
+		//p E [0, 100]
+		double Percentile(double p) const;
+
+	private:
+		std::vector<double> mSamples;
+	};
+
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(double& out_ms) : mOutMs(out_ms), mStart(std::chrono::high_resolution_clock::now()) {}
+		~ScopedTimer() { mOutMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mStart).count(); }
+	private:
+		double& mOutMs;
+		std::chrono::high_resolution_clock::time_point mStart;
+	};
+}
@@ -0,0 +1,192 @@
+#include "CascadedShadowMap.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	//extra cover around each cascade's bounding sphere, the cached cascade only moves in steps of this
+	constexpr float CASCADE_MARGIN = 0.25f;
+
+	void CreateDepthAtlas(GLuint& texture, GLuint& fbo, GLsizei size)
+	{
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, size, size);
+		//manual compare & PCF in the lighting shader
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			printf("[Shadow] Depth atlas framebuffer incomplete\n");
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+}
+
+void CascadedShadowMap::Generate(uint32_t cascade_resolution)
+{
+	Release();
+	mCascadeResolution = cascade_resolution;
+	const GLsizei atlas_size = static_cast<GLsizei>(2 * mCascadeResolution);
+	CreateDepthAtlas(mStaticAtlas, mStaticFBO, atlas_size);
+	CreateDepthAtlas(mLiveAtlas, mLiveFBO, atlas_size);
+	bStaticDirty = true;
+}
+
+void CascadedShadowMap::Release()
+{
+	if (mStaticFBO)
+		glDeleteFramebuffers(1, &mStaticFBO);
+	if (mLiveFBO)
+		glDeleteFramebuffers(1, &mLiveFBO);
+	if (mStaticAtlas)
+		glDeleteTextures(1, &mStaticAtlas);
+	if (mLiveAtlas)
+		glDeleteTextures(1, &mLiveAtlas);
+	mStaticFBO = mLiveFBO = mStaticAtlas = mLiveAtlas = 0;
+	for (auto& cascade : mCascades)
+		cascade = Cascade();
+}
+
+void CascadedShadowMap::Update(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& light_dir)
+{
+	mLastStaticRenders = 0;
+	bDynamicThisFrame = false;
+	bViewportSaved = false;
+
+	//glm::perspective => proj[2][2] = -(f + n)/(f - n), proj[3][2] = -2fn/(f - n)
+	const float near = proj[3][2] / (proj[2][2] - 1.0f);
+	const float far = std::min(proj[3][2] / (proj[2][2] + 1.0f), mShadowDistance);
+	//squared half diagonal slope of the frustum
+	const float k = 1.0f / (proj[0][0] * proj[0][0]) + 1.0f / (proj[1][1] * proj[1][1]);
+	const glm::vec3 camera_pos = glm::vec3(glm::inverse(view)[3]);
+
+	const glm::vec3 dir = glm::normalize(light_dir);
+	const glm::vec3 up = (std::abs(dir.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	//rotation only, looks along the direction the light travels
+	const glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), -dir, up);
+
+	for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++)
+	{
+		Cascade& cascade = mCascades[c];
+		//practical split scheme, log/linear blend
+		const float p = static_cast<float>(c + 1) / SHADOW_CASCADE_COUNT;
+		const float split_log = near * std::pow(far / near, p);
+		const float split_lin = near + (far - near) * p;
+		const float split_far = split_lin + (split_log - split_lin) * mSplitLambda;
+		cascade.splitFar = split_far;
+
+		//sphere around the camera through the far corners of the split => holds the slice for any view
+		//direction, camera rotation never invalidates the cache (costs texel density vs a per slice fit)
+		float radius = split_far * std::sqrt(1.0f + k);
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		//snap the centre in light space to whole steps (and those to whole texels),
+		//the cached cascade stays valid until the camera moves a step
+		const float half_extent = radius * (1.0f + CASCADE_MARGIN);
+		const float texel = 2.0f * half_extent / static_cast<float>(mCascadeResolution);
+		const float step = std::max(texel, std::floor(radius * CASCADE_MARGIN / texel) * texel);
+		glm::vec3 centre_ls = glm::vec3(light_view * glm::vec4(camera_pos, 1.0f));
+		centre_ls = glm::floor(centre_ls / step + 0.5f) * step;
+
+		const glm::mat4 light_proj = glm::ortho(centre_ls.x - half_extent, centre_ls.x + half_extent,
+												centre_ls.y - half_extent, centre_ls.y + half_extent,
+												-(centre_ls.z + half_extent + mCasterDistance), -(centre_ls.z - half_extent));
+		const glm::mat4 light_view_proj = light_proj * light_view;
+		if (bStaticDirty || light_view_proj != cascade.lightViewProj)
+		{
+			cascade.lightViewProj = light_view_proj;
+			cascade.bStaticStale = true;
+		}
+
+		//clip => [0, 1] => cascade tile in the 2x2 atlas
+		const glm::vec3 tile_offset = glm::vec3(0.5f * static_cast<float>(c % 2), 0.5f * static_cast<float>(c / 2), 0.0f);
+		cascade.atlasViewProj = glm::translate(glm::mat4(1.0f), tile_offset) *
+								glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 1.0f)) *
+								glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) *
+								glm::scale(glm::mat4(1.0f), glm::vec3(0.5f)) *
+								cascade.lightViewProj;
+	}
+	bStaticDirty = false;
+}
+
+void CascadedShadowMap::SaveViewport()
+{
+	if (bViewportSaved)
+		return;
+	glGetIntegerv(GL_VIEWPORT, mSavedViewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mSavedFBO);
+	bViewportSaved = true;
+}
+
+void CascadedShadowMap::BeginStaticCascade(uint32_t cascade)
+{
+	SaveViewport();
+	glBindFramebuffer(GL_FRAMEBUFFER, mStaticFBO);
+	SetCascadeViewport(cascade);
+
+	//clear only this tile
+	const GLint size = static_cast<GLint>(mCascadeResolution);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor((cascade % 2) * size, (cascade / 2) * size, size, size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glDisable(GL_SCISSOR_TEST);
+
+	mCascades[cascade].bStaticStale = false;
+	mLastStaticRenders++;
+	mTotalStaticRenders++;
+}
+
+void CascadedShadowMap::BeginDynamicPass()
+{
+	SaveViewport();
+	const GLsizei atlas_size = static_cast<GLsizei>(2 * mCascadeResolution);
+	glCopyImageSubData(mStaticAtlas, GL_TEXTURE_2D, 0, 0, 0, 0,
+					   mLiveAtlas, GL_TEXTURE_2D, 0, 0, 0, 0,
+					   atlas_size, atlas_size, 1);
+	glBindFramebuffer(GL_FRAMEBUFFER, mLiveFBO);
+	bDynamicThisFrame = true;
+}
+
+void CascadedShadowMap::SetCascadeViewport(uint32_t cascade) const
+{
+	const GLint size = static_cast<GLint>(mCascadeResolution);
+	glViewport((cascade % 2) * size, (cascade / 2) * size, size, size);
+}
+
+void CascadedShadowMap::EndPass()
+{
+	if (!bViewportSaved)
+		return;
+	glBindFramebuffer(GL_FRAMEBUFFER, mSavedFBO);
+	glViewport(mSavedViewport[0], mSavedViewport[1], mSavedViewport[2], mSavedViewport[3]);
+}
+
+void CascadedShadowMap::FillShadowParams(ShadowParamsBlock& block, const glm::mat4& inv_view, bool enable) const
+{
+	for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++)
+	{
+		block.lightViewProj[c] = mCascades[c].atlasViewProj;
+		block.splitDepths[c] = mCascades[c].splitFar;
+	}
+	block.invView = inv_view;
+	block.params = glm::vec4(mDepthBias, mSlopeBias, 0.0f, enable ? 1.0f : 0.0f);
+}
+
+void CascadedShadowMap::BindTexture(uint32_t unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, bDynamicThisFrame ? mLiveAtlas : mStaticAtlas);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// CASCADED SHADOW MAP
+//////////////////////////////////////////////////
+//SHADOW_CASCADE_COUNT cascades for the directional light packed 2x2 in one depth atlas (uShadowMap, binding 4).
+//Static casters are cached per cascade in their own atlas, a cascade is only re-rendered when its
+//light view projection changes (light direction, or the camera moving a snap step) or InvalidateStatic() is called.
+//Cascades are fit to spheres around the camera position, so turning the camera never re-renders static casters.
+//Dynamic casters are drawn each frame on top of a copy of the static atlas, without any the static atlas is sampled directly.
+constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+constexpr uint32_t SHADOW_PARAMS_UBO_BINDING = 2;
+
+//std140 uShadowParams in the lighting shader
+struct ShadowParamsBlock
+{
+	glm::mat4 lightViewProj[SHADOW_CASCADE_COUNT];	//world => atlas uv & depth
+	glm::mat4 invView;								//view => world, view space G-buffer path
+	glm::vec4 splitDepths;							//view space far of each cascade
+	glm::vec4 params;								//depth bias, slope bias, unused, enable
+};
+static_assert(sizeof(ShadowParamsBlock) == 352, "ShadowParamsBlock must match std140 uShadowParams");
+
+class CascadedShadowMap
+{
+public:
+	CascadedShadowMap() = default;
+	~CascadedShadowMap() { Release(); }
+
+	CascadedShadowMap(const CascadedShadowMap&) = delete;
+	CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+	//resolution per cascade, the atlas is twice that on each axis
+	void Generate(uint32_t cascade_resolution = 1024);
+	void Release();
+
+	//fits the cascades to the view (near/far from the glm perspective) & flags stale static cascades
+	//light_dir points towards the light (as mDirLight.direction)
+	void Update(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& light_dir);
+	//static casters changed (transform, added/removed), every cascade gets re-rendered
+	void InvalidateStatic() { bStaticDirty = true; }
+
+	bool NeedsStaticRender(uint32_t cascade) const { return mCascades[cascade].bStaticStale; }
+	//binds the static atlas with the cascade tile as viewport & clears it
+	void BeginStaticCascade(uint32_t cascade);
+	//copies the static atlas into the live one & binds it, SetCascadeViewport per cascade after
+	void BeginDynamicPass();
+	void SetCascadeViewport(uint32_t cascade) const;
+	//restores the framebuffer & viewport from the first Begin of the frame
+	void EndPass();
+
+	const glm::mat4& GetLightViewProj(uint32_t cascade) const { return mCascades[cascade].lightViewProj; }
+	void FillShadowParams(ShadowParamsBlock& block, const glm::mat4& inv_view, bool enable) const;
+	void BindTexture(uint32_t unit) const;
+
+	uint32_t GetCascadeResolution() const { return mCascadeResolution; }
+	float GetSplitDepth(uint32_t cascade) const { return mCascades[cascade].splitFar; }
+	uint32_t GetLastStaticRenderCount() const { return mLastStaticRenders; }
+	uint64_t GetTotalStaticRenderCount() const { return mTotalStaticRenders; }
+	bool UsedDynamicPass() const { return bDynamicThisFrame; }
+
+	//casters behind the cascade (towards the light) up to this distance are kept
+	float mCasterDistance = 60.0f;
+	float mShadowDistance = 60.0f;
+	float mSplitLambda = 0.75f;
+	float mDepthBias = 0.0005f;
+	float mSlopeBias = 0.002f;
+
+private:
+	struct Cascade
+	{
+		glm::mat4 lightViewProj = glm::mat4(0.0f);
+		glm::mat4 atlasViewProj = glm::mat4(0.0f);
+		float splitFar = 0.0f;
+		bool bStaticStale = true;
+	};
+	void SaveViewport();
+
+	GLuint mStaticAtlas = 0;
+	GLuint mLiveAtlas = 0;
+	GLuint mStaticFBO = 0;
+	GLuint mLiveFBO = 0;
+	uint32_t mCascadeResolution = 0;
+
+	std::array<Cascade, SHADOW_CASCADE_COUNT> mCascades;
+	bool bStaticDirty = true;
+	bool bDynamicThisFrame = false;
+	bool bViewportSaved = false;
+	GLint mSavedViewport[4] = {};
+	GLint mSavedFBO = 0;
+
+	uint32_t mLastStaticRenders = 0;
+	uint64_t mTotalStaticRenders = 0;
+};
@@ -0,0 +1,265 @@
+#include "ClusteredLighting.h"
+#include "SamplePatterns.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+
+void GenerateLocalLights(uint32_t count, uint32_t seed, float extent, std::vector<LocalLight>& lights)
+{
+	lights.clear();
+	lights.reserve(count);
+
+	//SamplePatterns helpers & one draw per statement => same lights on every toolchain
+	std::mt19937 rng(seed);
+	const float half_extent = 0.5f * extent;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		LocalLight light;
+		light.position.x = SamplePatterns::UniformFloat(rng, -half_extent, half_extent);
+		light.position.y = SamplePatterns::UniformFloat(rng, 0.3f, 3.0f);
+		light.position.z = SamplePatterns::UniformFloat(rng, -half_extent, half_extent);
+		for (int c = 0; c < 3; c++)
+			light.colour[c] = SamplePatterns::UniformFloat(rng, 0.2f, 1.0f);
+		light.intensity = SamplePatterns::UniformFloat(rng, 0.5f, 2.0f);
+		light.range = SamplePatterns::UniformFloat(rng, 1.5f, 5.0f);
+		//quarter spots aiming down
+		if (SamplePatterns::UniformFloat(rng) < 0.25f)
+		{
+			light.type = ELocalLightType::SPOT;
+			const float dir_x = SamplePatterns::UniformFloat(rng) - 0.5f;
+			const float dir_z = SamplePatterns::UniformFloat(rng) - 0.5f;
+			light.direction = glm::normalize(glm::vec3(dir_x, -1.0f, dir_z));
+			light.outerAngle = 20.0f + 25.0f * SamplePatterns::UniformFloat(rng);
+			light.innerAngle = light.outerAngle * 0.7f;
+		}
+		lights.push_back(light);
+	}
+}
+
+
+//////////////////////////////////////////////////
+// CLUSTERED LIGHT CULLER
+//////////////////////////////////////////////////
+void ClusteredLightCuller::Generate()
+{
+	Release();
+
+	//per cluster data only, light & index storage grows in Build
+	mClusterCounts.resize(CLUSTER_COUNT);
+	mClusterGrid.resize(CLUSTER_COUNT);
+	mSliceOffsets.resize(CLUSTER_GRID_Z);
+	mSliceOverflow.resize(CLUSTER_GRID_Z);
+	mClusterBounds.resize(CLUSTER_COUNT);
+
+	glGenBuffers(1, &mLightSSBO);
+	glGenBuffers(1, &mGridSSBO);
+	glGenBuffers(1, &mIndexSSBO);
+	//one element each so the bindings are valid before the first build
+	ReserveSSBO(mLightSSBO, mLightSSBOBytes, sizeof(GPULocalLight));
+	ReserveSSBO(mIndexSSBO, mIndexSSBOBytes, sizeof(uint32_t));
+	size_t grid_bytes = 0;
+	ReserveSSBO(mGridSSBO, grid_bytes, sizeof(glm::uvec2) * CLUSTER_COUNT);
+}
+
+void ClusteredLightCuller::ReserveSSBO(GLuint id, size_t& capacity, size_t bytes)
+{
+	if (bytes <= capacity)
+		return;
+	//x1.5 => light count drags in the UI do not reallocate every frame
+	capacity = std::max(bytes, capacity + capacity / 2);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ClusteredLightCuller::Release()
+{
+	GLuint buffers[] = { mLightSSBO, mGridSSBO, mIndexSSBO };
+	for (GLuint id : buffers)
+	{
+		if (id)
+			glDeleteBuffers(1, &id);
+	}
+	mLightSSBO = mGridSSBO = mIndexSSBO = 0;
+	mLightSSBOBytes = mIndexSSBOBytes = 0;
+	mCachedProj = glm::mat4(0.0f);
+
+	std::vector<GPULocalLight>().swap(mGPULights);
+	std::vector<uint32_t>().swap(mLightIndices);
+	for (auto& pairs : mSlicePairs)
+		std::vector<uint32_t>().swap(pairs);
+}
+
+void ClusteredLightCuller::RebuildClusterBounds(const glm::mat4& proj)
+{
+	mCachedProj = proj;
+	//glm::perspective => proj[2][2] = -(f + n)/(f - n), proj[3][2] = -2fn/(f - n)
+	mNear = proj[3][2] / (proj[2][2] - 1.0f);
+	mFar = proj[3][2] / (proj[2][2] + 1.0f);
+
+	const float inv_px = 1.0f / proj[0][0];
+	const float inv_py = 1.0f / proj[1][1];
+	for (uint32_t z = 0; z < CLUSTER_GRID_Z; z++)
+	{
+		//exponential slices, matches the shader's log based slice lookup
+		float depth_near = mNear * std::pow(mFar / mNear, static_cast<float>(z) / CLUSTER_GRID_Z);
+		float depth_far = mNear * std::pow(mFar / mNear, static_cast<float>(z + 1) / CLUSTER_GRID_Z);
+		for (uint32_t y = 0; y < CLUSTER_GRID_Y; y++)
+		{
+			float ndc_y0 = -1.0f + 2.0f * static_cast<float>(y) / CLUSTER_GRID_Y;
+			float ndc_y1 = -1.0f + 2.0f * static_cast<float>(y + 1) / CLUSTER_GRID_Y;
+			for (uint32_t x = 0; x < CLUSTER_GRID_X; x++)
+			{
+				float ndc_x0 = -1.0f + 2.0f * static_cast<float>(x) / CLUSTER_GRID_X;
+				float ndc_x1 = -1.0f + 2.0f * static_cast<float>(x + 1) / CLUSTER_GRID_X;
+
+				AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+				for (float depth : { depth_near, depth_far })
+				{
+					for (float ndc_x : { ndc_x0, ndc_x1 })
+					{
+						for (float ndc_y : { ndc_y0, ndc_y1 })
+						{
+							glm::vec3 corner(ndc_x * depth * inv_px, ndc_y * depth * inv_py, -depth);
+							bounds.min = glm::min(bounds.min, corner);
+							bounds.max = glm::max(bounds.max, corner);
+						}
+					}
+				}
+				mClusterBounds[(z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x] = bounds;
+			}
+		}
+	}
+}
+
+void ClusteredLightCuller::CullSlice(uint32_t slice)
+{
+	const uint32_t clusters_per_slice = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+	const uint32_t first_cluster = slice * clusters_per_slice;
+	const float slice_near = -mClusterBounds[first_cluster].max.z;
+	const float slice_far = -mClusterBounds[first_cluster].min.z;
+	uint32_t overflow = 0;
+	std::vector<uint32_t>& pairs = mSlicePairs[slice];
+	pairs.clear();
+
+	for (uint32_t c = 0; c < clusters_per_slice; c++)
+		mClusterCounts[first_cluster + c] = 0;
+
+	for (uint32_t l = 0; l < mLightCount; l++)
+	{
+		const glm::vec4& pos_range = mGPULights[l].positionRange;
+		//depth reject for the whole slice first
+		float depth = -pos_range.z;
+		if (depth + pos_range.w < slice_near || depth - pos_range.w > slice_far)
+			continue;
+
+		const glm::vec3 centre(pos_range);
+		const float range_sq = pos_range.w * pos_range.w;
+		for (uint32_t c = 0; c < clusters_per_slice; c++)
+		{
+			const uint32_t cluster = first_cluster + c;
+			const AABB& bounds = mClusterBounds[cluster];
+			//sphere vs AABB, spots use their bounding sphere
+			glm::vec3 closest = glm::clamp(centre, bounds.min, bounds.max);
+			glm::vec3 delta = closest - centre;
+			if (glm::dot(delta, delta) > range_sq)
+				continue;
+
+			uint32_t& count = mClusterCounts[cluster];
+			if (count < MAX_LIGHTS_PER_CLUSTER)
+			{
+				pairs.push_back((l << 8) | c);
+				count++;
+			}
+			else
+				overflow++;
+		}
+	}
+	mSliceOverflow[slice] = overflow;
+}
+
+void ClusteredLightCuller::ScatterSlice(uint32_t slice)
+{
+	constexpr uint32_t clusters_per_slice = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+	const uint32_t first_cluster = slice * clusters_per_slice;
+	std::array<uint32_t, clusters_per_slice> cursors;
+	uint32_t offset = mSliceOffsets[slice];
+	for (uint32_t c = 0; c < clusters_per_slice; c++)
+	{
+		const uint32_t count = mClusterCounts[first_cluster + c];
+		mClusterGrid[first_cluster + c] = glm::uvec2(offset, count);
+		cursors[c] = offset;
+		offset += count;
+	}
+	//pairs are in light order => every cluster list stays sorted by light
+	for (uint32_t pair : mSlicePairs[slice])
+		mLightIndices[cursors[pair & 0xFFu]++] = pair >> 8;
+}
+
+void ClusteredLightCuller::Build(const std::vector<LocalLight>& lights, const glm::mat4& view, const glm::mat4& proj, ThreadPool& job_pool)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (proj != mCachedProj)
+		RebuildClusterBounds(proj);
+
+	//lights to view space
+	const size_t max_lights = std::min(lights.size(), static_cast<size_t>(MAX_LOCAL_LIGHTS));
+	if (mGPULights.size() < max_lights)
+		mGPULights.resize(max_lights);
+	mLightCount = 0;
+	const glm::mat3 view_rot = glm::mat3(view);
+	for (const auto& light : lights)
+	{
+		if (!light.enable || light.range <= 0.0f)
+			continue;
+		if (mLightCount >= MAX_LOCAL_LIGHTS)
+			break;
+		GPULocalLight& gpu_light = mGPULights[mLightCount++];
+		gpu_light.positionRange = glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.range);
+		gpu_light.colourIntensity = glm::vec4(light.colour, light.intensity);
+		gpu_light.directionType = glm::vec4(glm::normalize(view_rot * light.direction), static_cast<float>(light.type));
+		gpu_light.spotCone = glm::vec4(std::cos(glm::radians(light.innerAngle)), std::cos(glm::radians(light.outerAngle)), 0.0f, 0.0f);
+	}
+
+	//one job per depth slice, slices never share clusters
+	job_pool.ParallelFor(CLUSTER_GRID_Z, [this](uint32_t slice) { CullSlice(slice); });
+
+	//slice prefix sum => where each slice's lists start in the packed index list
+	mTotalIndices = 0;
+	mOverflowCount = 0;
+	for (uint32_t slice = 0; slice < CLUSTER_GRID_Z; slice++)
+	{
+		mSliceOffsets[slice] = mTotalIndices;
+		mTotalIndices += static_cast<uint32_t>(mSlicePairs[slice].size());
+		mOverflowCount += mSliceOverflow[slice];
+	}
+	if (mLightIndices.size() < mTotalIndices)
+		mLightIndices.resize(mTotalIndices);
+	job_pool.ParallelFor(CLUSTER_GRID_Z, [this](uint32_t slice) { ScatterSlice(slice); });
+	mMaxLightsInCluster = *std::max_element(mClusterCounts.begin(), mClusterCounts.end());
+
+	//upload only what is used
+	ReserveSSBO(mLightSSBO, mLightSSBOBytes, sizeof(GPULocalLight) * mLightCount);
+	ReserveSSBO(mIndexSSBO, mIndexSSBOBytes, sizeof(uint32_t) * mTotalIndices);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mLightSSBO);
+	if (mLightCount > 0)
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPULocalLight) * mLightCount, mGPULights.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mGridSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glm::uvec2) * CLUSTER_COUNT, mClusterGrid.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mIndexSSBO);
+	if (mTotalIndices > 0)
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(uint32_t) * mTotalIndices, mLightIndices.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	mLastBuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ClusteredLightCuller::Bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LOCAL_LIGHT_SSBO_BINDING, mLightSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_SSBO_BINDING, mGridSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_SSBO_BINDING, mIndexSSBO);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "ThreadPool.h"
+
+//////////////////////////////////////////////////
+// CLUSTERED (FROXEL) LIGHTING
+//////////////////////////////////////////////////
+//View frustum split into CLUSTER_GRID_X x CLUSTER_GRID_Y screen tiles & CLUSTER_GRID_Z exponential depth slices.
+//Light lists are built on the CPU, one depth slice per job, and uploaded as SSBOs:
+//binding 0 => lights (view space), binding 1 => per cluster (offset, count), binding 2 => light indices
+//Each slice job collects (light, cluster) pairs, a prefix sum over the slices places them in one packed
+//index list => storage follows the actual pair count & only grows once clustering is in use.
+constexpr uint32_t CLUSTER_GRID_X = 16;
+constexpr uint32_t CLUSTER_GRID_Y = 9;
+constexpr uint32_t CLUSTER_GRID_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+static_assert(CLUSTER_GRID_X * CLUSTER_GRID_Y <= 256, "cluster within a slice is packed into 8 bits");
+//bounds the per pixel light loop only, no storage is sized from it
+constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 512;
+constexpr uint32_t MAX_LOCAL_LIGHTS = 8192;
+
+constexpr uint32_t LOCAL_LIGHT_SSBO_BINDING = 0;
+constexpr uint32_t CLUSTER_GRID_SSBO_BINDING = 1;
+constexpr uint32_t CLUSTER_INDEX_SSBO_BINDING = 2;
+
+enum class ELocalLightType : uint32_t
+{
+	POINT,
+	SPOT,
+};
+
+//world space authoring data
+struct LocalLight
+{
+	ELocalLightType type = ELocalLightType::POINT;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); //spot only
+	glm::vec3 colour = glm::vec3(1.0f);
+	float intensity = 1.0f;
+	float range = 4.0f;
+	float innerAngle = 20.0f; //degrees, spot only
+	float outerAngle = 30.0f;
+	bool enable = true;
+};
+
+//std430 LocalLight in the lighting shader
+struct GPULocalLight
+{
+	glm::vec4 positionRange;	//view space xyz, range
+	glm::vec4 colourIntensity;
+	glm::vec4 directionType;	//view space xyz, type
+	glm::vec4 spotCone;			//cos inner, cos outer
+};
+static_assert(sizeof(GPULocalLight) == 64, "GPULocalLight must match std430 LocalLight");
+
+void GenerateLocalLights(uint32_t count, uint32_t seed, float extent, std::vector<LocalLight>& lights);
+
+class ClusteredLightCuller
+{
+public:
+	ClusteredLightCuller() = default;
+	~ClusteredLightCuller() { Release(); }
+
+	ClusteredLightCuller(const ClusteredLightCuller&) = delete;
+	ClusteredLightCuller& operator=(const ClusteredLightCuller&) = delete;
+
+	void Generate();
+	void Release();
+
+	//near/far are taken from the projection (glm perspective)
+	void Build(const std::vector<LocalLight>& lights, const glm::mat4& view, const glm::mat4& proj, ThreadPool& job_pool);
+	void Bind() const;
+
+	uint32_t GetLightCount() const { return mLightCount; }
+	float GetNear() const { return mNear; }
+	float GetFar() const { return mFar; }
+	double GetLastBuildMs() const { return mLastBuildMs; }
+	uint32_t GetTotalLightIndices() const { return mTotalIndices; }
+	uint32_t GetMaxLightsInCluster() const { return mMaxLightsInCluster; }
+	//lights dropped because a cluster was full
+	uint32_t GetOverflowCount() const { return mOverflowCount; }
+
+private:
+	struct AABB
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	void RebuildClusterBounds(const glm::mat4& proj);
+	//pairs & per cluster counts of a slice
+	void CullSlice(uint32_t slice);
+	//per cluster offsets & index list of a slice, after the slice prefix sum
+	void ScatterSlice(uint32_t slice);
+	//grows to at least bytes, contents are not kept
+	static void ReserveSSBO(GLuint id, size_t& capacity, size_t bytes);
+
+	GLuint mLightSSBO = 0;
+	GLuint mGridSSBO = 0;
+	GLuint mIndexSSBO = 0;
+	size_t mLightSSBOBytes = 0;
+	size_t mIndexSSBOBytes = 0;
+
+	//cluster bounds only change with the projection
+	glm::mat4 mCachedProj = glm::mat4(0.0f);
+	float mNear = 0.1f;
+	float mFar = 100.0f;
+	std::vector<AABB> mClusterBounds;
+
+	//per build scratch, grows with the light & pair counts, never shrinks till Release
+	std::vector<GPULocalLight> mGPULights;
+	std::vector<uint32_t> mClusterCounts;
+	std::array<std::vector<uint32_t>, CLUSTER_GRID_Z> mSlicePairs;	//light << 8 | cluster within the slice
+	std::vector<glm::uvec2> mClusterGrid;	//offset, count
+	std::vector<uint32_t> mLightIndices;
+	std::vector<uint32_t> mSliceOffsets;
+	std::vector<uint32_t> mSliceOverflow;
+
+	uint32_t mLightCount = 0;
+	uint32_t mTotalIndices = 0;
+	uint32_t mMaxLightsInCluster = 0;
+	uint32_t mOverflowCount = 0;
+	double mLastBuildMs = 0.0;
+};
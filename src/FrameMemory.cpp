@@ -0,0 +1,247 @@
+#include "FrameMemory.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace FrameMemory
+{
+	//////////////////////////////////////////////////
+	// FRAME ARENA
+	//////////////////////////////////////////////////
+	void FrameArena::Reserve(size_t capacity_bytes)
+	{
+		mBuffer = std::make_unique<std::byte[]>(capacity_bytes);
+		mCapacity = capacity_bytes;
+		mOffset = 0;
+		mHighWaterMark = 0;
+		mOverflowCount = 0;
+	}
+
+	void FrameArena::Reset()
+	{
+		mOffset = 0;
+	}
+
+	void* FrameArena::AllocateBytes(size_t size, size_t alignment)
+	{
+		//alignment is always a power of 2 (alignof)
+		size_t aligned_offset = (mOffset + (alignment - 1)) & ~(alignment - 1);
+		if (!mBuffer || aligned_offset + size > mCapacity)
+		{
+			mOverflowCount++;
+			return nullptr;
+		}
+		mOffset = aligned_offset + size;
+		if (mOffset > mHighWaterMark)
+			mHighWaterMark = mOffset;
+		return mBuffer.get() + aligned_offset;
+	}
+
+
+	//////////////////////////////////////////////////
+	// ALLOCATION TRACKER
+	//////////////////////////////////////////////////
+	namespace
+	{
+		//plain data only, this is touched from inside operator new
+		thread_local bool tlIsTrackingThread = false;
+		bool sIsFrameActive = false;
+		uint64_t sFrameIndex = 0;
+		uint64_t sSteadyStateWarmupFrames = 120;
+		uint64_t sSteadyStateViolations = 0;
+
+		AllocationStats sCurrFrame{ "Frame" };
+		std::array<AllocationStats, MAX_TRACKED_PASSES> sCurrPasses{};
+		size_t sCurrPassCount = 0;
+		int sActivePassIdx = -1;
+
+		AllocationStats sLastFrame{ "Frame" };
+		std::array<AllocationStats, MAX_TRACKED_PASSES> sLastPasses{};
+		size_t sLastPassCount = 0;
+	}
+
+	void AllocationTracker::BeginFrame()
+	{
+		//frame left open (no UI this frame) => close it first
+		EndFrame();
+		tlIsTrackingThread = true;
+		sIsFrameActive = true;
+		sCurrFrame.allocCount = 0;
+		sCurrFrame.allocBytes = 0;
+		sCurrPassCount = 0;
+		sActivePassIdx = -1;
+	}
+
+	void AllocationTracker::EndFrame()
+	{
+		if (!sIsFrameActive)
+			return;
+		sIsFrameActive = false;
+
+		sLastFrame = sCurrFrame;
+		sLastPasses = sCurrPasses;
+		sLastPassCount = sCurrPassCount;
+
+		if (sFrameIndex >= sSteadyStateWarmupFrames && sCurrFrame.allocCount > 0)
+			sSteadyStateViolations++;
+		sFrameIndex++;
+	}
+
+	void AllocationTracker::BeginPass(const char* name)
+	{
+		if (!sIsFrameActive || sCurrPassCount >= MAX_TRACKED_PASSES)
+			return;
+		sActivePassIdx = static_cast<int>(sCurrPassCount++);
+		sCurrPasses[sActivePassIdx] = { name, 0, 0 };
+	}
+
+	void AllocationTracker::EndPass()
+	{
+		sActivePassIdx = -1;
+	}
+
+	void AllocationTracker::RecordAllocation(size_t size)
+	{
+		if (!tlIsTrackingThread || !sIsFrameActive)
+			return;
+		sCurrFrame.allocCount++;
+		sCurrFrame.allocBytes += size;
+		if (sActivePassIdx >= 0)
+		{
+			sCurrPasses[sActivePassIdx].allocCount++;
+			sCurrPasses[sActivePassIdx].allocBytes += size;
+		}
+	}
+
+	const AllocationStats& AllocationTracker::GetLastFrameStats()
+	{
+		return sLastFrame;
+	}
+
+	const std::array<AllocationStats, MAX_TRACKED_PASSES>& AllocationTracker::GetLastFramePassStats()
+	{
+		return sLastPasses;
+	}
+
+	size_t AllocationTracker::GetLastFramePassCount()
+	{
+		return sLastPassCount;
+	}
+
+	uint64_t AllocationTracker::GetFrameIndex()
+	{
+		return sFrameIndex;
+	}
+
+	uint64_t AllocationTracker::GetSteadyStateViolationCount()
+	{
+		return sSteadyStateViolations;
+	}
+
+	void AllocationTracker::SetSteadyStateWarmupFrames(uint64_t frames)
+	{
+		sSteadyStateWarmupFrames = frames;
+	}
+
+	void AllocationTracker::ResetSteadyStateViolations()
+	{
+		sSteadyStateViolations = 0;
+		sFrameIndex = 0;
+	}
+
+	void* TrackedMalloc(size_t size, void*)
+	{
+		AllocationTracker::RecordAllocation(size);
+		return std::malloc(size ? size : 1);
+	}
+
+	void TrackedFree(void* ptr, void*)
+	{
+		std::free(ptr);
+	}
+}
+
+
+//////////////////////////////////////////////////
+// GLOBAL OPERATOR NEW/DELETE HOOK
+//////////////////////////////////////////////////
+#ifdef AO_TRACK_HEAP_ALLOCATIONS
+namespace
+{
+	void* TrackedAlloc(size_t size)
+	{
+		FrameMemory::AllocationTracker::RecordAllocation(size);
+		if (size == 0)
+			size = 1;
+		return std::malloc(size);
+	}
+
+	void* TrackedAlignedAlloc(size_t size, std::align_val_t alignment)
+	{
+		FrameMemory::AllocationTracker::RecordAllocation(size);
+		const size_t align = static_cast<size_t>(alignment);
+#ifdef _MSC_VER
+		return _aligned_malloc(size ? size : 1, align);
+#else
+		//aligned_alloc wants a multiple of the alignment
+		return std::aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+#endif
+	}
+
+	void TrackedAlignedFree(void* ptr)
+	{
+#ifdef _MSC_VER
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+}
+
+void* operator new(size_t size)
+{
+	if (void* ptr = TrackedAlloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	if (void* ptr = TrackedAlloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+//over aligned types (alignas > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (void* ptr = TrackedAlignedAlloc(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	if (void* ptr = TrackedAlignedAlloc(size, alignment))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlignedAlloc(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlignedAlloc(size, alignment); }
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { TrackedAlignedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedAlignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedAlignedFree(ptr); }
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <array>
+#include <type_traits>
+
+//////////////////////////////////////////////////
+// FRAME MEMORY
+//////////////////////////////////////////////////
+//Transient per frame memory & heap allocation instrumentation.
+//The arena is reserved once at initialisation and reset at the start of every frame,
+//anything that only lives for a frame (scratch vectors, texture upload data) should come from here.
+//
+//Heap instrumentation hooks the global operator new/delete (plain & aligned) when built with AO_TRACK_HEAP_ALLOCATIONS
+//(cmake -DAO_TRACK_HEAP_ALLOCATIONS=ON), otherwise the trackers exist but always report zero.
+//Libraries with their own malloc based allocator hooks (ImGui) are routed through TrackedMalloc/TrackedFree.
+namespace FrameMemory
+{
+	class FrameArena
+	{
+	public:
+		FrameArena() = default;
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		void Reserve(size_t capacity_bytes);
+		void Reset();
+
+		//Only for trivially destructible data, nothing gets destructed on Reset
+		template<typename T>
+		T* Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "FrameArena only holds trivially destructible types");
+			return static_cast<T*>(AllocateBytes(sizeof(T) * count, alignof(T)));
+		}
+
+		size_t GetUsed() const { return mOffset; }
+		size_t GetCapacity() const { return mCapacity; }
+		size_t GetHighWaterMark() const { return mHighWaterMark; }
+		//number of requests that did not fit & fell back to nullptr since last Reserve
+		uint32_t GetOverflowCount() const { return mOverflowCount; }
+
+	private:
+		void* AllocateBytes(size_t size, size_t alignment);
+
+		std::unique_ptr<std::byte[]> mBuffer = nullptr;
+		size_t mCapacity = 0;
+		size_t mOffset = 0;
+		size_t mHighWaterMark = 0;
+		uint32_t mOverflowCount = 0;
+	};
+
+
+	constexpr size_t MAX_TRACKED_PASSES = 16;
+	struct AllocationStats
+	{
+		const char* name = nullptr; //<-- string literals only, never owned
+		uint32_t allocCount = 0;
+		uint64_t allocBytes = 0;
+	};
+
+	//Main thread frame allocation tracker, other threads never contribute.
+	//Frame => BeginFrame()...EndFrame(), pass => PassScope within a frame.
+	//BeginFrame() closes a frame that was never ended.
+	class AllocationTracker
+	{
+	public:
+		static constexpr bool IsInstrumented()
+		{
+#ifdef AO_TRACK_HEAP_ALLOCATIONS
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static void BeginFrame();
+		static void EndFrame();
+		static void BeginPass(const char* name);
+		static void EndPass();
+
+		//called from the operator new hook
+		static void RecordAllocation(size_t size);
+
+		//last completed frame
+		static const AllocationStats& GetLastFrameStats();
+		static const std::array<AllocationStats, MAX_TRACKED_PASSES>& GetLastFramePassStats();
+		static size_t GetLastFramePassCount();
+		static uint64_t GetFrameIndex();
+		//frames that allocated after the steady state warm up
+		static uint64_t GetSteadyStateViolationCount();
+		static void SetSteadyStateWarmupFrames(uint64_t frames);
+		static void ResetSteadyStateViolations();
+	};
+
+	//malloc/free that count like operator new, user data is unused (ImGui::SetAllocatorFunctions signature)
+	void* TrackedMalloc(size_t size, void* user_data);
+	void TrackedFree(void* ptr, void* user_data);
+
+	struct PassScope
+	{
+		PassScope(const char* name) { AllocationTracker::BeginPass(name); }
+		~PassScope() { AllocationTracker::EndPass(); }
+	};
+}
+
+#define FRAME_MEM_CONCAT_INTERNAL(a, b) a##b
+#define FRAME_MEM_CONCAT(a, b) FRAME_MEM_CONCAT_INTERNAL(a, b)
+#define FRAME_ALLOC_PASS_SCOPE(name) FrameMemory::PassScope FRAME_MEM_CONCAT(frame_alloc_pass_scope_, __LINE__)(name)
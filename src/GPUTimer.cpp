@@ -0,0 +1,68 @@
+#include "GPUTimer.h"
+
+void GPUQueryRing::Generate(GLenum target)
+{
+	Release();
+	mTarget = target;
+	glGenQueries(GPU_TIMER_QUERY_LATENCY, mQueries.data());
+	mPending.fill(false);
+	mNextQuery = 0;
+	mLastResult = 0;
+}
+
+void GPUQueryRing::Release()
+{
+	if (mQueries[0])
+		glDeleteQueries(GPU_TIMER_QUERY_LATENCY, mQueries.data());
+	mQueries.fill(0);
+	mPending.fill(false);
+}
+
+void GPUQueryRing::Begin()
+{
+	//ring full => oldest result is dropped (only read when available)
+	GetLastResult();
+	mPending[mNextQuery] = false;
+	glBeginQuery(mTarget, mQueries[mNextQuery]);
+}
+
+void GPUQueryRing::End()
+{
+	glEndQuery(mTarget);
+	mPending[mNextQuery] = true;
+	mNextQuery = (mNextQuery + 1) % GPU_TIMER_QUERY_LATENCY;
+}
+
+uint64_t GPUQueryRing::GetLastResult()
+{
+	//oldest first, newest available result wins
+	for (uint32_t i = 0; i < GPU_TIMER_QUERY_LATENCY; i++)
+	{
+		uint32_t idx = (mNextQuery + i) % GPU_TIMER_QUERY_LATENCY;
+		if (!mPending[idx])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(mQueries[idx], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(mQueries[idx], GL_QUERY_RESULT, &result);
+		mPending[idx] = false;
+		mLastResult = static_cast<uint64_t>(result);
+	}
+	return mLastResult;
+}
+
+uint64_t GPUQueryRing::ResolveLatestResult()
+{
+	uint32_t latest = (mNextQuery + GPU_TIMER_QUERY_LATENCY - 1) % GPU_TIMER_QUERY_LATENCY;
+	if (mPending[latest])
+	{
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(mQueries[latest], GL_QUERY_RESULT, &result);
+		mLastResult = static_cast<uint64_t>(result);
+	}
+	//older ones are stale now
+	mPending.fill(false);
+	return mLastResult;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+
+#include <array>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// GPU QUERIES
+//////////////////////////////////////////////////
+//Queries in a small ring, results are read a few frames late so nothing stalls.
+//Only one query per target can be active at a time (GL limitation), passes are sequential anyway.
+constexpr uint32_t GPU_TIMER_QUERY_LATENCY = 4;
+class GPUQueryRing
+{
+public:
+	GPUQueryRing() = default;
+	~GPUQueryRing() { Release(); }
+
+	GPUQueryRing(const GPUQueryRing&) = delete;
+	GPUQueryRing& operator=(const GPUQueryRing&) = delete;
+
+	void Generate(GLenum target);
+	void Release();
+
+	void Begin();
+	void End();
+
+	//latest available result, polls finished queries
+	uint64_t GetLastResult();
+	//blocks for the most recent query, for benchmarks after glFinish
+	uint64_t ResolveLatestResult();
+
+private:
+	GLenum mTarget = GL_TIME_ELAPSED;
+	std::array<GLuint, GPU_TIMER_QUERY_LATENCY> mQueries{};
+	std::array<bool, GPU_TIMER_QUERY_LATENCY> mPending{};
+	uint32_t mNextQuery = 0;
+	uint64_t mLastResult = 0;
+};
+
+//GL_TIME_ELAPSED
+class GPUTimer : public GPUQueryRing
+{
+public:
+	void Generate() { GPUQueryRing::Generate(GL_TIME_ELAPSED); }
+	double GetLastMs() { return static_cast<double>(GetLastResult()) * 1e-6; }
+	double ResolveLatestMs() { return static_cast<double>(ResolveLatestResult()) * 1e-6; }
+};
+
+//GL_SAMPLES_PASSED, fragments that passed the depth test (i.e. got shaded & written)
+class GPUSampleCounter : public GPUQueryRing
+{
+public:
+	void Generate() { GPUQueryRing::Generate(GL_SAMPLES_PASSED); }
+};
+
+template<typename TQuery>
+struct ScopedGPUQuery
+{
+	ScopedGPUQuery(TQuery& query) : mQuery(query) { mQuery.Begin(); }
+	~ScopedGPUQuery() { mQuery.End(); }
+	TQuery& mQuery;
+};
+using ScopedGPUTimer = ScopedGPUQuery<GPUTimer>;
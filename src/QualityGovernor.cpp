@@ -0,0 +1,117 @@
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	//samples, resolution scale, blur radius
+	//sample counts above the kernel size are clamped by the caller, top rung 0 => the full configured kernel
+	constexpr std::array<SSAOQualityLevel, QUALITY_LEVEL_COUNT> QUALITY_LADDER =
+	{ {
+		{ 8, 0.5f, 1 },
+		{ 12, 0.5f, 2 },
+		{ 16, 0.75f, 2 },
+		{ 24, 0.75f, 2 },
+		{ 32, 0.75f, 2 },
+		{ 32, 1.0f, 2 },
+		{ 48, 1.0f, 2 },
+		{ 0, 1.0f, 2 },
+	} };
+	//far over budget => skip a rung
+	constexpr float LARGE_OVERSHOOT = 1.5f;
+}
+
+void SSAOQualityGovernor::Reset(uint32_t level)
+{
+	mLevel = std::min(level, QUALITY_LEVEL_COUNT - 1);
+	mSmoothedMs = 0.0f;
+	mLastMeasuredMs = 0.0f;
+	bHasSample = false;
+	mFrame = 0;
+	mLastChangeFrame = 0;
+	mLastUpgradeFrame = 0;
+	bLastChangeUpgrade = false;
+	mFramesOver = 0;
+	mFramesUnder = 0;
+	mBackoff = 0;
+	mLogHead = 0;
+	mLogCount = 0;
+}
+
+bool SSAOQualityGovernor::Update(float frame_ms)
+{
+	mFrame++;
+	mLastMeasuredMs = frame_ms;
+	mSmoothedMs = bHasSample ? mSmoothedMs + (frame_ms - mSmoothedMs) * mSmoothing : frame_ms;
+	bHasSample = true;
+
+	//timers lag a few frames & the filter has to catch up before the new level is judged
+	if (mFrame - mLastChangeFrame < mSettleFrames)
+		return false;
+
+	const bool over = mSmoothedMs > mTargetMs * (1.0f + mUpperBand);
+	const bool under = mSmoothedMs < mTargetMs * (1.0f - mLowerBand);
+	mFramesOver = over ? mFramesOver + 1 : 0;
+	mFramesUnder = under ? mFramesUnder + 1 : 0;
+
+	if (over && mFramesOver >= mDowngradeFrames && mLevel > 0)
+	{
+		uint32_t steps = (mSmoothedMs > mTargetMs * LARGE_OVERSHOOT) ? 2 : 1;
+		uint32_t to_level = mLevel - std::min(steps, mLevel);
+		//upgrade did not hold => wait longer before trying again
+		bool reverted = bLastChangeUpgrade && (mFrame - mLastUpgradeFrame) < static_cast<uint64_t>(mSettleFrames + mUpgradeFrames);
+		mBackoff = reverted ? std::min(mBackoff + 1, MAX_GOVERNOR_BACKOFF) : 0;
+
+		bLastChangeUpgrade = false;
+		ChangeLevel(to_level, reverted);
+		return true;
+	}
+
+	if (under && mFramesUnder >= (mUpgradeFrames << mBackoff) && mLevel + 1 < QUALITY_LEVEL_COUNT)
+	{
+		bLastChangeUpgrade = true;
+		mLastUpgradeFrame = mFrame;
+		ChangeLevel(mLevel + 1, false);
+		return true;
+	}
+	return false;
+}
+
+void SSAOQualityGovernor::ChangeLevel(uint32_t level, bool reverted_upgrade)
+{
+	mLog[mLogHead] = { mFrame, mSmoothedMs, mTargetMs, static_cast<uint8_t>(mLevel), static_cast<uint8_t>(level), reverted_upgrade };
+	mLogHead = (mLogHead + 1) % MAX_GOVERNOR_LOG_ENTRIES;
+	mLogCount = std::min(mLogCount + 1, MAX_GOVERNOR_LOG_ENTRIES);
+
+	mLevel = level;
+	mLastChangeFrame = mFrame;
+	mFramesOver = 0;
+	mFramesUnder = 0;
+}
+
+const SSAOQualityLevel& SSAOQualityGovernor::GetLevelSettings(uint32_t level)
+{
+	return QUALITY_LADDER[std::min(level, QUALITY_LEVEL_COUNT - 1)];
+}
+
+const GovernorLogEntry& SSAOQualityGovernor::GetLogEntry(uint32_t idx) const
+{
+	uint32_t oldest = (mLogHead + MAX_GOVERNOR_LOG_ENTRIES - mLogCount) % MAX_GOVERNOR_LOG_ENTRIES;
+	return mLog[(oldest + idx) % MAX_GOVERNOR_LOG_ENTRIES];
+}
+
+void SSAOQualityGovernor::PrintLog() const
+{
+	for (uint32_t i = 0; i < mLogCount; i++)
+	{
+		const GovernorLogEntry& entry = GetLogEntry(i);
+		const SSAOQualityLevel& level = GetLevelSettings(entry.toLevel);
+		char samples[16] = "full";
+		if (level.sampleCount > 0)
+			snprintf(samples, sizeof(samples), "%d", level.sampleCount);
+		printf("[Quality Governor] frame %6llu  %7.3fms (target %.3fms)  level %u => %u  (%s samples, %.2fx res, blur %d)%s\n",
+			   static_cast<unsigned long long>(entry.frame), entry.smoothedMs, entry.targetMs, entry.fromLevel, entry.toLevel,
+			   samples, level.resolutionScale, level.blurRadius, entry.bRevertedUpgrade ? "  reverted upgrade" : "");
+	}
+}
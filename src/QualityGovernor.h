@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// SSAO QUALITY GOVERNOR
+//////////////////////////////////////////////////
+//Closed loop controller holding a frame time target by stepping along a fixed quality ladder.
+//Measured times are smoothed (EMA), a downgrade needs mDowngradeFrames consecutive frames above
+//target * (1 + mUpperBand), an upgrade mUpgradeFrames below target * (1 - mLowerBand) (hysteresis).
+//After a change the controller settles for mSettleFrames (timer query latency + EMA catch up).
+//An upgrade that gets reverted straight away doubles the next upgrade wait (no ping-pong).
+//Levels only change per frame values (kernel subset, viewport, blur taps) so no GPU resource
+//or kernel is rebuilt on a step => no hitch.
+constexpr uint32_t QUALITY_LEVEL_COUNT = 8;
+constexpr uint32_t MAX_GOVERNOR_LOG_ENTRIES = 64;
+constexpr uint32_t MAX_GOVERNOR_BACKOFF = 3;
+
+//one rung of the ladder, cheapest first
+struct SSAOQualityLevel
+{
+	int sampleCount;		//evenly spaced subset of the uploaded kernel, 0 => full kernel
+	float resolutionScale;	//SSAO target sub rect
+	int blurRadius;			//2r x 2r box
+};
+
+struct GovernorLogEntry
+{
+	uint64_t frame;
+	float smoothedMs;
+	float targetMs;
+	uint8_t fromLevel;
+	uint8_t toLevel;
+	bool bRevertedUpgrade;
+};
+
+class SSAOQualityGovernor
+{
+public:
+	//jumps to level, clears the filter, counters, back off & log
+	void Reset(uint32_t level = QUALITY_LEVEL_COUNT - 1);
+	//one sample per frame, returns true when the level changed
+	bool Update(float frame_ms);
+
+	uint32_t GetLevel() const { return mLevel; }
+	static const SSAOQualityLevel& GetLevelSettings(uint32_t level);
+	const SSAOQualityLevel& GetLevelSettings() const { return GetLevelSettings(mLevel); }
+	float GetSmoothedMs() const { return mSmoothedMs; }
+	float GetLastMeasuredMs() const { return mLastMeasuredMs; }
+	uint64_t GetFrame() const { return mFrame; }
+	uint32_t GetBackoff() const { return mBackoff; }
+
+	//oldest first, older entries are overwritten once full
+	uint32_t GetLogCount() const { return mLogCount; }
+	const GovernorLogEntry& GetLogEntry(uint32_t idx) const;
+	void PrintLog() const;
+
+	float mTargetMs = 16.6f;
+	float mUpperBand = 0.05f;
+	float mLowerBand = 0.15f;
+	float mSmoothing = 0.1f;			//EMA weight of the newest frame
+	uint32_t mDowngradeFrames = 8;
+	uint32_t mUpgradeFrames = 60;
+	uint32_t mSettleFrames = 16;
+
+private:
+	//logs the decision & restarts the settle window
+	void ChangeLevel(uint32_t level, bool reverted_upgrade);
+
+	uint32_t mLevel = QUALITY_LEVEL_COUNT - 1;
+	float mSmoothedMs = 0.0f;
+	float mLastMeasuredMs = 0.0f;
+	bool bHasSample = false;
+	uint64_t mFrame = 0;
+	uint64_t mLastChangeFrame = 0;
+	uint64_t mLastUpgradeFrame = 0;
+	bool bLastChangeUpgrade = false;
+	uint32_t mFramesOver = 0;
+	uint32_t mFramesUnder = 0;
+	uint32_t mBackoff = 0;
+
+	std::array<GovernorLogEntry, MAX_GOVERNOR_LOG_ENTRIES> mLog{};
+	uint32_t mLogHead = 0;
+	uint32_t mLogCount = 0;
+};
@@ -11,51 +11,139 @@
 #include "pregl/Core/UI_Window_Panel_Editors.h"
 #include <imgui/imgui.h>
 
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
 void SSAO::ResizeNoiseScale(unsigned int width, unsigned int height)
 {
-	float noise_sizef = static_cast<float>(noiseSize);
+	screenWidth = static_cast<int>(width);
+	screenHeigth = static_cast<int>(height);
+	float noise_sizef = static_cast<float>(GetNoiseTextureSize());
 	noiseScale = glm::vec2(static_cast<float>(width) / noise_sizef, static_cast<float>(height) / noise_sizef);
-	bIsDirtySampleParameter = true;
 }
 
 void SSAO::GenerateSamplePoint(std::vector<glm::vec3>& sample_kernel)
 {
-	auto randomf = Util::Random::gRngFloat01;
+	//seeded => same kernel every run for A/B comparisons
+	std::mt19937 rng(static_cast<uint32_t>(kernelSeed));
+	auto randomf = [&]() { return SamplePatterns::UniformFloat(rng); };
+	//draws in a fixed order (argument evaluation order is unspecified)
+	auto random3 = [&]() { float x = randomf(); float y = randomf(); return glm::vec3(x, y, randomf()); };
 	sample_kernel.resize(kernelSize);
 	//disttribution -> distribution type starts at 0.0f
 	float distribution_pow = static_cast<float>(distribution) + 1.0f;
-	for (size_t i = 0; i < kernelSize; i++)
+	if (kernelPattern == KernelPattern::RANDOM)
 	{
-		glm::vec3 v = glm::vec3(
-			randomf() * 2.0f - 1.0f, // x E [-1, 1]
-			randomf() * 2.0f - 1.0f,// y E [-1, 1]
-			randomf());			     // z E [0, 1]
-			//randomf() * 2.0f - 1.0f);// z E [-1, 1]
+		for (size_t i = 0; i < kernelSize; i++)
+		{
+			glm::vec3 v = random3();
+			if (bCosineWeighted)
+				v = SamplePatterns::HemisphereDirection(v.x, v.y, true);
+			else
+			{
+				//x, y E [-1, 1], z E [0, 1]
+				v.x = v.x * 2.0f - 1.0f;
+				v.y = v.y * 2.0f - 1.0f;
+				//normalise to anchor to the hemisphere surface
+				if (glm::length(v) > 1e-5f)
+					v = glm::normalize(v);
+				else
+					v = glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+			//per point distance through the distribution curve like the other patterns, no slot
+			//dependence => any subset of the kernel spans the whole radius range
+			v *= glm::mix(minDist, maxDist, glm::pow(randomf(), distribution_pow));
+			sample_kernel[i] = v;
+		}
+		return;
+	}
 
-		//normalise to anchor to the hemisphere surface
-		if (glm::length(v) > 1e-5f)
-			v = glm::normalize(v);
-		else
-			v = glm::vec3(0.0f, 0.0f, 1.0f);
-		v *= randomf();
+	//u.xy => direction, u.z => distance along it (distribution curve applied to it instead of the slot)
+	//seed => toroidal shift of the set (Cranley-Patterson), patterns stay low discrepancy
+	const glm::vec3 shift = random3();
+	auto wrap = [](float u) { return u - std::floor(u); };
+	std::vector<uint32_t> strata[2];
+	std::vector<uint32_t> halton_order;
+	if (kernelPattern == KernelPattern::STRATIFIED)
+	{
+		for (auto& stratum : strata)
+		{
+			stratum.resize(kernelSize);
+			for (int i = 0; i < kernelSize; i++)
+				stratum[i] = static_cast<uint32_t>(i);
+			SamplePatterns::Shuffle(stratum, rng);
+		}
+	}
+	else if (kernelPattern == KernelPattern::HALTON)
+		SamplePatterns::BitReversalOrder(static_cast<uint32_t>(kernelSize), halton_order);
 
-		float scale = static_cast<float>(i) / kernelSize;
-		scale = glm::mix(minDist, maxDist, glm::pow(scale, distribution_pow));
-		v *= scale;
+	const float inv_count = 1.0f / static_cast<float>(kernelSize);
+	constexpr float INV_GOLDEN_RATIO = 0.618033988749895f;
+	constexpr float INV_PLASTIC_SQ = 0.569840290998053f;
+	for (int i = 0; i < kernelSize; i++)
+	{
+		glm::vec3 u;
+		switch (kernelPattern)
+		{
+		case KernelPattern::STRATIFIED:
+			//slot order strata on the elevation so strided subsets cover it
+			u = (glm::vec3(static_cast<float>(i), static_cast<float>(strata[0][i]), static_cast<float>(strata[1][i])) + random3()) * inv_count;
+			break;
+		case KernelPattern::HALTON:
+		{
+			//skip index 0 (origin)
+			uint32_t idx = halton_order[i] + 1;
+			u = glm::vec3(wrap(SamplePatterns::RadicalInverse(idx, 2) + shift.x),
+						  wrap(SamplePatterns::RadicalInverse(idx, 3) + shift.y),
+						  wrap(SamplePatterns::RadicalInverse(idx, 5) + shift.z));
+			break;
+		}
+		case KernelPattern::FIBONACCI:
+		default:
+			//lattice, any stride through it is still spread out
+			u = glm::vec3(wrap((static_cast<float>(i) + 0.5f) * inv_count + shift.x),
+						  wrap(static_cast<float>(i) * INV_GOLDEN_RATIO + shift.y),
+						  wrap(static_cast<float>(i) * INV_PLASTIC_SQ + shift.z));
+			break;
+		}
+		glm::vec3 v = SamplePatterns::HemisphereDirection(u.x, u.y, bCosineWeighted);
+		v *= glm::mix(minDist, maxDist, glm::pow(u.z, distribution_pow));
 		sample_kernel[i] = v;
 	}
 }
 
-void SSAO::GenerateNoiseTexture(std::shared_ptr<GPUResource::Texture>& noise_texture)
+void SSAO::GenerateNoiseTexture(std::shared_ptr<GPUResource::Texture>& noise_texture, FrameMemory::FrameArena& arena, ThreadPool& pool)
 {
-	std::vector<glm::vec3>noise_vector;
+	if (noiseType == NoiseType::BLUE)
+		blueNoiseSize = std::clamp(blueNoiseSize, 1, static_cast<int>(MAX_BLUE_NOISE_SIZE));
+	const int noise_size = GetNoiseTextureSize();
 	//noise is the count on an axes 
-	noise_vector.reserve(noiseSize * noiseSize);
-	auto randomf = Util::Random::RNG<float>(Util::Random::rnd_b4mt, -1.0f, 1.0f);
-	for (uint16_t i = 0; i < noiseSize * noiseSize; i++)
+	const size_t noise_count = static_cast<size_t>(noise_size * noise_size);
+	glm::vec3* noise_data = arena.Allocate<glm::vec3>(noise_count);
+	PGL_ASSERT_CRITICAL(noise_data, "Frame arena too small for SSAO noise data");
+	if (noiseType == NoiseType::BLUE)
 	{
-		glm::vec3 noise(randomf(), randomf(), 0.0f);
-		noise_vector.push_back(glm::normalize(noise));
+		//rank => rotation angle, neighbouring texels get far apart angles
+		std::vector<uint32_t> ranks;
+		SamplePatterns::LoadOrGenerateBlueNoise(static_cast<uint32_t>(noise_size), static_cast<uint32_t>(noiseSeed), pool, ranks);
+		const float inv_count = 1.0f / static_cast<float>(noise_count);
+		for (size_t i = 0; i < noise_count; i++)
+		{
+			float angle = glm::radians(360.0f) * (static_cast<float>(ranks[i]) + 0.5f) * inv_count;
+			noise_data[i] = glm::vec3(std::cos(angle), std::sin(angle), 0.0f);
+		}
+	}
+	else
+	{
+		std::mt19937 rng(static_cast<uint32_t>(noiseSeed));
+		auto randomf = [&]() { return SamplePatterns::UniformFloat(rng) * 2.0f - 1.0f; };
+		for (size_t i = 0; i < noise_count; i++)
+		{
+			float x = randomf();
+			glm::vec3 noise(x, randomf(), 0.0f);
+			noise_data[i] = (glm::length(noise) > 1e-5f) ? glm::normalize(noise) : glm::vec3(1.0f, 0.0f, 0.0f);
+		}
 	}
 	GPUResource::TextureParameter tex{
 		//GPUResource::IMGFormat::RGBA,
@@ -70,7 +158,9 @@ void SSAO::GenerateNoiseTexture(std::shared_ptr<GPUResource::Texture>& noise_tex
 	//clear from GPU, quick hack fix later
 	if (noise_texture)
 		noise_texture->Clear();
-	noise_texture = std::make_shared<GPUResource::Texture>(noiseSize, noiseSize, &noise_vector[0], tex);
+	noise_texture = std::make_shared<GPUResource::Texture>(noise_size, noise_size, noise_data, tex);
+	//tiling follows the texture size
+	ResizeNoiseScale(static_cast<unsigned int>(screenWidth), static_cast<unsigned int>(screenHeigth));
 }
 
 
@@ -82,6 +172,10 @@ void SSAOProgram::OnInitialise(AppWindow* display_window)
 {
 	display_window->ChangeWindowTitle("SSAO");
 	mDisplayManager = display_window;
+	//ImGui allocates through its own malloc hooks, never operator new => count those too.
+	//Context already exists, safe to swap as both sides are malloc/free
+	if (FrameMemory::AllocationTracker::IsInstrumented())
+		ImGui::SetAllocatorFunctions(FrameMemory::TrackedMalloc, FrameMemory::TrackedFree);
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -92,24 +186,51 @@ void SSAOProgram::OnInitialise(AppWindow* display_window)
 
 void SSAOProgram::OnUpdate(float delta_time)
 {
-	UpdateUBOs(*mCamera, mDisplayManager->GetAspectRatio());
+	FrameMemory::AllocationTracker::BeginFrame();
+	mFrameArena.Reset();
+
+	float aspect_ratio = mDisplayManager->GetAspectRatio();
+	RenderFrame({ mCamera->GetPosition(), mCamera->mFar, mCamera->ProjMat(aspect_ratio), mCamera->ViewMat() });
+	UpdateQualityGovernor();
+	//frame stays open till the end of OnUI so the editors are tracked too
+}
+
+void SSAOProgram::RenderFrame(const FrameView& view)
+{
+	if (bClusteredLighting)
+	{
+		//before the UBO update, cluster near/far go into uFrameParams
+		FRAME_ALLOC_PASS_SCOPE("Light culling");
+		mLightCuller.Build(mLocalLights, view.view, view.proj, mJobPool);
+	}
+
+	{
+		FRAME_ALLOC_PASS_SCOPE("Shadow");
+		RenderShadowPass(view);
+	}
+
+	{
+		FRAME_ALLOC_PASS_SCOPE("UBO update");
+		UpdateUBOs(view);
+	}
 
 	glDisable(GL_BLEND);
-	//Render to Render Target 
-	mGBuffer_VS.Bind();
-	//main scene render pass
-	glClearColor(mClearColour.r, mClearColour.g, mClearColour.b, mClearColour.a);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	DrawScene(mGeometryShader_VS, true);
-	mGBuffer_VS.UnBind();
+	if (mGBufferMode == EGBufferMode::VISIBILITY_BUFFER)
+	{
+		FRAME_ALLOC_PASS_SCOPE("Visibility");
+		RenderVisibilityPass();
+	}
 
+	{
+		FRAME_ALLOC_PASS_SCOPE("GBuffer VS");
+		RenderGBuffer(mGBuffer_VS, mGeometryShader_VS, EGPUPass::GBUFFER_VS, false);
+	}
 
-	mGBuffer_WS.Bind();
-	//main scene render pass
-	glClearColor(mClearColour.r, mClearColour.g, mClearColour.b, mClearColour.a);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	DrawScene(mGeometryShader_WS, true);
-	mGBuffer_WS.UnBind();
+
+	{
+		FRAME_ALLOC_PASS_SCOPE("GBuffer WS");
+		RenderGBuffer(mGBuffer_WS, mGeometryShader_WS, EGPUPass::GBUFFER_WS, true);
+	}
 
 
 	auto sampling_gbuffer = &mGBuffer_VS;
@@ -117,46 +238,76 @@ void SSAOProgram::OnUpdate(float delta_time)
 		sampling_gbuffer = &mGBuffer_WS;
 
 	//SSAO pass 
-	mSSAOFBO.Bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	mSSAOShader.Bind();
-	mSSAOShader.SetUniform1i("uPosition", 0);
-	mSSAOShader.SetUniform1i("uNormal", 1);
-	mSSAOShader.SetUniform1i("uNoiseTex", 2);
-	if (mSSAOParameters.bIsDirtySampleParameter)
-	{
-		mSSAOShader.SetUniform1f("uRadius", mSSAOParameters.sampleRadius);
-		mSSAOShader.SetUniform1f("uPower", mSSAOParameters.power);
-		mSSAOShader.SetUniform1f("uBias", mSSAOParameters.bias);
-		mSSAOShader.SetUniform1i("uKernelSize", mSSAOParameters.kernelSize);
-		mSSAOShader.SetUniformVec2("uNoiseScale", mSSAOParameters.noiseScale);
-		mSSAOParameters.bIsDirtySampleParameter = false;
-	}
-	if (mSSAOParameters.bIsDirtySampleKernel)
-	{
-		mSSAOParameters.GenerateSamplePoint(mSamplingKernelPoints);
-		for (int i = 0; i < mSamplingKernelPoints.size(); ++i)
-			mSSAOShader.SetUniformVec3(("uSamples[" + std::to_string(i) + "]").c_str(), mSamplingKernelPoints[i]);
-		mSSAOParameters.bIsDirtySampleKernel = false;
-	}
-	if (mSSAOParameters.bIsDirtyNoiseParameter)
-	{
-		mSSAOParameters.GenerateNoiseTexture(mNoiseTex);
-		mSSAOParameters.bIsDirtyNoiseParameter = false;
-	}
-	//MRT 
-	//position => 0
-	//normal => 1
-	//albedo spec => 2
-	//material data => 3
-	sampling_gbuffer->BindTextureIdx(0, 0);
-	sampling_gbuffer->BindTextureIdx(1, 1);
-	mNoiseTex->Activate(2);
-	mSSAOShader.SetUniformMat4("uProjection", mCamera->ProjMat(mDisplayManager->GetAspectRatio()));
-	mSSAOShader.SetUniform1i("uWSSample", (mEAOSampleType == EAOSampleType::WS_SAMPLE));
-	mMeshBuffer[1].Draw();
-	mSSAOFBO.UnBind();
+	{
+		FRAME_ALLOC_PASS_SCOPE("SSAO");
+		mGPUTimers[static_cast<size_t>(EGPUPass::SSAO)].Begin();
+		//samplers use layout bindings, sample parameters come from uFrameParams
+		if (mSSAOParameters.bIsDirtySampleKernel)
+		{
+			mSSAOParameters.GenerateSamplePoint(mSamplingKernelPoints);
+			for (Shader* shader : { &mSSAOShader, &mSSAOTileShader })
+			{
+				shader->Bind();
+				for (int i = 0; i < mSamplingKernelPoints.size(); ++i)
+					shader->SetUniformVec3(mSampleUniformNames[i].data(), mSamplingKernelPoints[i]);
+			}
+			mSSAOParameters.bIsDirtySampleKernel = false;
+		}
+		if (mSSAOParameters.bIsDirtyNoiseParameter)
+		{
+			mSSAOParameters.GenerateNoiseTexture(mNoiseTex, mFrameArena, mJobPool);
+			mSSAOParameters.bIsDirtyNoiseParameter = false;
+		}
+		if (bAdaptiveSSAO)
+		{
+			//per tile budget class, both G-buffers hold the same surfaces => classify the view space one
+			mSSAOTileClassifyShader.Bind();
+			mSSAOTileClassifyShader.SetUniform1f("uDepthThreshold", mSSAOTileDepthThreshold);
+			mSSAOTileClassifyShader.SetUniform1f("uNormalThreshold", mSSAOTileNormalThreshold);
+			mGBuffer_VS.BindTextureIdx(0, 0);
+			mGBuffer_VS.BindTextureIdx(1, 1);
+			mSSAOTiles.BeginClassify();
+			mMeshBuffer[1].Draw();
+			mSSAOTiles.EndClassify();
+		}
+		mSSAOFBO.Bind();
+		glClear(GL_COLOR_BUFFER_BIT);
+		//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		//resolution scale => sub rect of the full size target, nothing reallocated when it changes
+		const uint32_t screen_width = mDisplayManager->GetWidth();
+		const uint32_t screen_height = mDisplayManager->GetHeight();
+		glViewport(0, 0, static_cast<GLsizei>(std::ceil(screen_width * mSSAOParameters.resolutionScale)),
+				   static_cast<GLsizei>(std::ceil(screen_height * mSSAOParameters.resolutionScale)));
+		//MRT 
+		//position => 0
+		//normal => 1
+		//albedo spec => 2
+		//material data => 3
+		sampling_gbuffer->BindTextureIdx(0, 0);
+		sampling_gbuffer->BindTextureIdx(1, 1);
+		mNoiseTex->Activate(2);
+		if (bAdaptiveSSAO)
+		{
+			//one indirect draw per budget class, same sample count across a draw
+			const auto budgets = SSAOTileClassifier::ComputeBudgets(mSSAOParameters.GetEffectiveSampleCount());
+			mSSAOTileShader.Bind();
+			mSSAOTiles.BindTileList();
+			for (uint32_t c = 0; c < SSAO_BUDGET_CLASS_COUNT; c++)
+			{
+				mSSAOTileShader.SetUniform1i("uTileClass", static_cast<int>(c));
+				mSSAOTileShader.SetUniform1i("uAdaptiveKernelSize", budgets[c]);
+				mSSAOTiles.DrawClass(c);
+			}
+		}
+		else
+		{
+			mSSAOShader.Bind();
+			mMeshBuffer[1].Draw();
+		}
+		glViewport(0, 0, screen_width, screen_height);
+		mSSAOFBO.UnBind();
+		mGPUTimers[static_cast<size_t>(EGPUPass::SSAO)].End();
+	}
 
 
 
@@ -170,44 +321,37 @@ void SSAOProgram::OnUpdate(float delta_time)
 
 
 	//deffered light shading 
-	mGBufferDeferredLighting.Bind();
-	mGBufferDeferredLighting.SetUniformVec3("uDirectionalLight.direction", mDirLight.direction);
-	//diffuse
-	mGBufferDeferredLighting.SetUniformVec3("uDirectionalLight.diffuse", mDirLight.base.diffuse);
-	//ambient
-	//mGBufferDefferedLighting.SetUniformVec3("uDirectionalLight.ambient", mDirLight.base.ambient);
-	//specular
-	mGBufferDeferredLighting.SetUniformVec3("uDirectionalLight.specular", mDirLight.base.specular);
-	mGBufferDeferredLighting.SetUniform1i("uDirectionalLight.enable", mDirLight.base.enable);
-	//mGBufferDefferedLighting.SetUniform1i("uPhongRendering", 0);
-	mGBufferDeferredLighting.SetUniform1i("uEnableAO", mSSAOParameters.bShadingEnable);
-	mGBufferDeferredLighting.SetUniform1i("uBlurAO", mSSAOParameters.bBlurEnable);
-
-	mGBufferDeferredLighting.SetUniform1i("uAlbedoSpec", 0);
-	mGBufferDeferredLighting.SetUniform1i("uPosition", 1);
-	mGBufferDeferredLighting.SetUniform1i("uNormal", 2);
-	mGBufferDeferredLighting.SetUniform1i("uMaterialData", 3);
-	mGBufferDeferredLighting.SetUniform1i("uSSAO", 5);
-	mGBufferDeferredLighting.SetUniform1i("uOnlyAORender", bOnlyRenderAONoLighting);
-	mGBufferDeferredLighting.SetUniform1i("uWSSample", (mEAOSampleType == EAOSampleType::WS_SAMPLE));
-	//MRT 
-//position => 0
-//normal => 1
-//albedo spec => 2
-//material data => 3
-	sampling_gbuffer->BindTextureIdx(0, 1);
-	sampling_gbuffer->BindTextureIdx(1, 2);
-	sampling_gbuffer->BindTextureIdx(2, 0);
-	sampling_gbuffer->BindTextureIdx(3, 3);
-	mSSAOFBO.BindTexture(5);
-	//for (int i = 0; i < 64; ++i)
-	//	mPostRenderTargetShader.SetUniformVec3(("uSamples[" + std::to_string(i) + "]").c_str(), mSamplingKernelPoints[i]);
-	//mPostRenderTargetShader.SetUniformMat4("uProjection", mCamera->ProjMat(mDisplayManager->GetAspectRatio()));
-	//mNoiseTex->Activate(2);
-	//draw screen quad (/just a basic quad)
-	mMeshBuffer[1].Draw();
+	//light & AO flags come from uFrameParams, samplers use layout bindings
+	{
+		FRAME_ALLOC_PASS_SCOPE("Deferred lighting");
+		mGPUTimers[static_cast<size_t>(EGPUPass::LIGHTING)].Begin();
+		mGBufferDeferredLighting.Bind();
+		//MRT 
+	//position => 0
+	//normal => 1
+	//albedo spec => 2
+	//material data => 3
+		sampling_gbuffer->BindTextureIdx(0, 1);
+		sampling_gbuffer->BindTextureIdx(1, 2);
+		sampling_gbuffer->BindTextureIdx(2, 0);
+		sampling_gbuffer->BindTextureIdx(3, 3);
+		mShadowMap.BindTexture(4);
+		mSSAOFBO.BindTexture(5);
+		mSSAOTiles.BindTileClassTexture(6);
+		//local lights => SSBO 0, 1, 2
+		mLightCuller.Bind();
+		//for (int i = 0; i < 64; ++i)
+		//	mPostRenderTargetShader.SetUniformVec3(("uSamples[" + std::to_string(i) + "]").c_str(), mSamplingKernelPoints[i]);
+		//mPostRenderTargetShader.SetUniformMat4("uProjection", mCamera->ProjMat(mDisplayManager->GetAspectRatio()));
+		//mNoiseTex->Activate(2);
+		//draw screen quad (/just a basic quad)
+		mMeshBuffer[1].Draw();
+		mGPUTimers[static_cast<size_t>(EGPUPass::LIGHTING)].End();
+
+		glDisable(GL_BLEND);
+	}
 
-	glDisable(GL_BLEND);
+	mUniformRing.EndFrame();
 }
 
 void SSAOProgram::OnLateUpdate(float delta_time)
@@ -217,9 +361,27 @@ void SSAOProgram::OnLateUpdate(float delta_time)
 
 void SSAOProgram::OnDestroy()
 {
+	mLightCuller.Release();
+	mShadowMap.Release();
+	mVisBuffer.Release();
+	mSSAOTiles.Release();
+	mPrepassSamples.Release();
+	mGeometrySamples.Release();
+	mResolveSamples.Release();
+	for (auto& timer : mGPUTimers)
+		timer.Release();
 }
 
 void SSAOProgram::OnUI()
+{
+	{
+		FRAME_ALLOC_PASS_SCOPE("UI");
+		EditorsUI();
+	}
+	FrameMemory::AllocationTracker::EndFrame();
+}
+
+void SSAOProgram::EditorsUI()
 {
 	GameObjectsInspectorEditor(mGameObjects);
 
@@ -228,21 +390,13 @@ void SSAOProgram::OnUI()
 	UI::Windows::RenderTargetViewport(mSSAOFBO);
 
 	UI::Windows::SingleTextureEditor(*mNoiseTex, "Noise Texture Debug!!!!!!");
+	FrameAllocationsEditor();
+	SceneGeneratorEditor();
+	LocalLightsEditor();
+	OverdrawEditor();
+	QualityGovernorEditor();
 
-
-	//quick hack 
-	static UI::Windows::MaterialList material_list{};
-	if (material_list.size() != mMaterialBuffer.size())
-	{
-		material_list.clear();
-		material_list.reserve(mMaterialBuffer.size());
-		for (auto& m : mMaterialBuffer)
-		{
-			material_list.push_back(m);
-
-		}
-	}
-	UI::Windows::MaterialsEditor(material_list);
+	UI::Windows::MaterialsEditor(mMaterialList);
 
 
 	//{
@@ -283,6 +437,61 @@ void SSAOProgram::OnUI()
 		ImGui::SliderFloat("min distribution", &mSSAOParameters.minDist, 0.0f, 1.0f, "%.2f");
 		ImGui::SliderFloat("max distribution", &mSSAOParameters.maxDist, 0.0f, 1.0f, "%.2f");
 
+		int curr_pattern = static_cast<int>(mSSAOParameters.kernelPattern);
+		auto pattern_as_string_array = SSAO::KernelPatternToStringArray;
+		if (ImGui::Combo("Kernel pattern", &curr_pattern, pattern_as_string_array.data(), pattern_as_string_array.size()))
+			mSSAOParameters.kernelPattern = static_cast<SSAO::KernelPattern>(curr_pattern);
+		ImGui::Checkbox("Cosine weighted", &mSSAOParameters.bCosineWeighted);
+		//seeds rebuild the kernel/noise (blue noise blocks & caches per seed), apply on enter not per keystroke
+		int kernel_seed = mSSAOParameters.kernelSeed;
+		if (ImGui::InputInt("Kernel seed", &kernel_seed, 1, 100, ImGuiInputTextFlags_EnterReturnsTrue))
+			mSSAOParameters.kernelSeed = kernel_seed;
+
+		int curr_noise_type = static_cast<int>(mSSAOParameters.noiseType);
+		auto noise_type_as_string_array = SSAO::NoiseTypeToStringArray;
+		if (ImGui::Combo("Noise type", &curr_noise_type, noise_type_as_string_array.data(), noise_type_as_string_array.size()))
+			mSSAOParameters.noiseType = static_cast<SSAO::NoiseType>(curr_noise_type);
+		if (mSSAOParameters.noiseType == SSAO::NoiseType::BLUE)
+			ImGui::SliderInt("Blue noise size", &mSSAOParameters.blueNoiseSize, 8, static_cast<int>(MAX_BLUE_NOISE_SIZE));
+		int noise_seed = mSSAOParameters.noiseSeed;
+		if (ImGui::InputInt("Noise seed", &noise_seed, 1, 100, ImGuiInputTextFlags_EnterReturnsTrue))
+			mSSAOParameters.noiseSeed = noise_seed;
+
+		ImGui::SeparatorText("Adaptive samples (8x8 tiles)");
+		ImGui::Checkbox("Adaptive", &bAdaptiveSSAO);
+		if (bAdaptiveSSAO)
+		{
+			ImGui::Checkbox("Sample heatmap", &bSSAOHeatmap);
+			ImGui::SliderFloat("Depth variance threshold", &mSSAOTileDepthThreshold, 0.001f, 0.5f, "%.3f");
+			ImGui::SliderFloat("Normal variance threshold", &mSSAOTileNormalThreshold, 0.001f, 0.5f, "%.3f");
+			const auto budgets = SSAOTileClassifier::ComputeBudgets(mSSAOParameters.GetEffectiveSampleCount());
+			ImGui::Text("Budgets: %d / %d / %d / %d", budgets[0], budgets[1], budgets[2], budgets[3]);
+			//blocking readback, only while ticked
+			ImGui::Checkbox("Tile stats (stalls)", &bSSAOTileStats);
+			if (bSSAOTileStats)
+			{
+				std::array<uint32_t, SSAO_BUDGET_CLASS_COUNT> counts;
+				mSSAOTiles.ReadClassCounts(counts);
+				double samples = 0.0;
+				uint32_t tiles = 0;
+				for (uint32_t c = 0; c < SSAO_BUDGET_CLASS_COUNT; c++)
+				{
+					samples += static_cast<double>(counts[c]) * budgets[c];
+					tiles += counts[c];
+				}
+				ImGui::Text("Tiles per class: %u / %u / %u / %u", counts[0], counts[1], counts[2], counts[3]);
+				ImGui::Text("Avg samples per pixel: %.1f (full kernel %d)", tiles ? samples / tiles : 0.0, mSSAOParameters.kernelSize);
+			}
+		}
+
+		ImGui::SeparatorText("Quality");
+		//owned by the governor while it runs
+		ImGui::BeginDisabled(bQualityGovernor);
+		ImGui::SliderInt("Sample count (0 => kernel)", &mSSAOParameters.sampleCount, 0, mSSAOParameters.kernelSize);
+		ImGui::SliderFloat("Resolution scale", &mSSAOParameters.resolutionScale, 0.25f, 1.0f, "%.2f");
+		ImGui::SliderInt("Blur radius", &mSSAOParameters.blurRadius, 0, 4);
+		ImGui::EndDisabled();
+
 		mSSAOParameters == prev_ssao;
 		//mSSAOParameters.CompareSSAOSampleKernelDirty(prev_ssao);
 		//mSSAOParameters.CompareSSAOParameterDirty(prev_ssao);
@@ -315,6 +524,25 @@ void SSAOProgram::OnUI()
 			ImGui::ColorEdit3("Ambient colour", &mDirLight.base.ambient[0]);
 			ImGui::ColorEdit3("Specular colour", &mDirLight.base.specular[0]);
 
+			//////////////////////////////////////
+			// Shadows
+			//////////////////////////////////////
+			ImGui::Spacing();
+			ImGui::SeparatorText("Cascaded Shadows");
+			ImGui::Checkbox("Enable shadows", &bShadowsEnabled);
+			bool shadow_changed = ImGui::DragFloat("Shadow distance", &mShadowMap.mShadowDistance, 0.5f, 5.0f, 500.0f, "%.1f");
+			shadow_changed |= ImGui::SliderFloat("Split lambda", &mShadowMap.mSplitLambda, 0.0f, 1.0f, "%.2f");
+			shadow_changed |= ImGui::DragFloat("Caster distance", &mShadowMap.mCasterDistance, 0.5f, 0.0f, 500.0f, "%.1f");
+			if (shadow_changed)
+				mShadowMap.InvalidateStatic();
+			ImGui::SliderFloat("Depth bias", &mShadowMap.mDepthBias, 0.0f, 0.01f, "%.5f");
+			ImGui::SliderFloat("Slope bias", &mShadowMap.mSlopeBias, 0.0f, 0.01f, "%.5f");
+			ImGui::Text("Cascades: %u x %upx, splits %.1f / %.1f / %.1f / %.1f", SHADOW_CASCADE_COUNT, mShadowMap.GetCascadeResolution(),
+						mShadowMap.GetSplitDepth(0), mShadowMap.GetSplitDepth(1), mShadowMap.GetSplitDepth(2), mShadowMap.GetSplitDepth(3));
+			ImGui::Text("Static re-renders: %u this frame, %llu total", mShadowMap.GetLastStaticRenderCount(),
+						static_cast<unsigned long long>(mShadowMap.GetTotalStaticRenderCount()));
+			ImGui::Text("Dynamic casters: %zu%s", mDynamicObjectCount, mShadowMap.UsedDynamicPass() ? " (composited)" : "");
+
 		}
 		ImGui::End();
 	}
@@ -369,7 +597,135 @@ void SSAOProgram::InitSceneData()
 	new_mat.diffuse = glm::vec3(0.4f, 0.6f, 0.8f);
 	new_mat.specular = glm::vec3(0.4f, 0.6f, 0.8f);
 	mMaterialBuffer.push_back(std::make_shared<BaseMaterial>(new_mat));
+	mAuthoredMaterialCount = mMaterialBuffer.size();
+	RefreshMaterialList();
+
+	//procedural scene spawn table => mesh buffer slot, weight, base scale, floor offset
+	mProceduralSceneDesc.meshSlots =
+	{
+		{ 0, 1.0f, 1.0f, 0.4f },	//sphere
+		{ 2, 1.0f, 1.0f, 0.5f },	//cube
+		{ 3, 0.25f, 1.0f, 0.0f },	//furniture
+		{ 4, 0.1f, 0.005f, 0.0f },	//keyboard
+	};
+
+
+	CreateDefaultScene();
+
+	////////////////////////////////////////
+	// UNIFORM BUFFERs
+	////////////////////////////////////////
+	//------------------Per Frame Uniform Ring-----------------------------/
+	//camera (uCameraMat) & frame params (uFrameParams) written per frame, bound by offset
+	mUniformRing.Generate(4 * 1024, 3);
+
+	mDirLight.direction = glm::vec3(-1.0f, 1.0f, -0.2f);
+
+	//------------------Clustered Local Lights-----------------------------/
+	mLightCuller.Generate();
+	LoadLocalLights(static_cast<uint32_t>(mLocalLightCount), mLocalLightSeed);
+	for (auto& timer : mGPUTimers)
+		timer.Generate();
+
+	//------------------Cascaded Shadow Map-----------------------------/
+	mShadowMap.Generate(1024);
+	mShadowDepthShader.Create("shadow depth", "assets/shaders/AO/ShadowDepth.vert", "assets/shaders/AO/ShadowDepth.frag");
+
+
+	mSSAOShader.Create("ssao shader", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/SSAO.frag");
+	mShaderHotReloaderTracker.AddShader(&mSSAOShader);
+	mSSAOTileShader.Create("ssao tile shader", "assets/shaders/AO/SSAOTile.vert", "assets/shaders/AO/SSAO.frag");
+	mShaderHotReloaderTracker.AddShader(&mSSAOTileShader);
+	mSSAOTileClassifyShader.Create("ssao tile classify", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/SSAOTileClassify.frag");
+	mShaderHotReloaderTracker.AddShader(&mSSAOTileClassifyShader);
+
+	PGL_ASSERT_CRITICAL(mDisplayManager, "No Display Window to retrive screen dimension from");
+	GPUResource::TextureParameter render_target_para[4] =
+	{
+		{GPUResource::IMGFormat::RGB16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
+		{GPUResource::IMGFormat::RGB16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
+		{GPUResource::IMGFormat::RGBA8, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
+		{GPUResource::IMGFormat::RGBA16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
+	};
+	mGBuffer_VS.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), 4, {}, render_target_para);
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::MultiRenderTarget::ResizeBuffer, &mGBuffer_VS);
+	mGeometryShader_VS.Create("scene geometry shader vs", "assets/shaders/AO/ViewSpaceGBuffer.vert", "assets/shaders/AO/ViewSpaceGBuffer.frag");
+
+	//world space buffer
+	mGBuffer_WS.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), 4, {}, render_target_para);
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::MultiRenderTarget::ResizeBuffer, &mGBuffer_WS);
+	mGeometryShader_WS.Create("scene geometry shader ws", "assets/shaders/AO/WorldSpaceGBuffer.vert", "assets/shaders/AO/WorldSpaceGBuffer.frag");
+	mShaderHotReloaderTracker.AddShader(&mGeometryShader_WS);
+
+	//vert --> need to output screen size quad
+	//frag --> process the Guffer outputs with light data 
+	mGBufferDeferredLighting.Create("deffered lighting", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/ViewSpaceDeferredLighting.frag");
+	mGBufferDeferredLighting.SetUniformBlockIdx("uCameraMat", 0);
+	mShaderHotReloaderTracker.AddShader(&mGBufferDeferredLighting);
+
+	//depth pre-pass & visibility buffer (see EGBufferMode)
+	mDepthPrepassShader.Create("depth prepass", "assets/shaders/AO/DepthPrepass.vert", "assets/shaders/AO/DepthPrepass.frag");
+	mVisibilityShader.Create("visibility buffer", "assets/shaders/AO/VisibilityBuffer.vert", "assets/shaders/AO/VisibilityBuffer.frag");
+	mVisibilityResolveShader.Create("visibility resolve", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/VisibilityResolve.frag");
+	mShaderHotReloaderTracker.AddShader(&mVisibilityResolveShader);
+	mVisBuffer.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), MAX_MATERIAL_BUFFER_SIZE);
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &VisibilityBuffer::Resize, &mVisBuffer);
+	mPrepassSamples.Generate();
+	mGeometrySamples.Generate();
+	mResolveSamples.Generate();
+
+	GPUResource::TextureParameter fbo_tex_para =
+	{
+		//GPUResource::IMGFormat::R16F,
+		GPUResource::IMGFormat::RED,
+		GPUResource::TextureType::RENDER,
+		GPUResource::TexWrapMode::CLAMP_EDGE,
+		GPUResource::TexFilterMode::NEAREST,
+		GPUResource::DataType::FLOAT,
+		false,
+		GPUResource::IMGFormat::RED
+	};
+	mSSAOFBO.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), { false }, fbo_tex_para);
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::Framebuffer::ResizeBuffer2, &mSSAOFBO);
+	mSSAOTiles.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight());
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &SSAOTileClassifier::Resize, &mSSAOTiles);
+
+	////////////////////
+	//SSAO Datas 
+	////////////////////
+	//Best SSAO 
+	mSSAOParameters.power = 1.0f; // 3.05f;
+	mSSAOParameters.sampleRadius = 0.5f; // 2.38f;
+	mSSAOParameters.bias = 0.025f; // 0.622f;
+	//default value
+	//mSSAOParameters.noiseSize = 4;
+	//mSSAOParameters.kernelSize = 64;
+	//mSSAOParameters.screenWidth = 1920;
+	//mSSAOParameters.screenHeigth = 1080;
+	//mSSAOParameters.noiseScale = glm::vec2(1920.0f / 4.0f, 1080.0f / 4.0f);
+
+	//transient frame data (noise upload etc), sized well above a frame's need
+	mFrameArena.Reserve(256 * 1024);
+	for (int i = 0; i < MAX_SSAO_KERNEL_SIZE; ++i)
+		snprintf(mSampleUniformNames[i].data(), mSampleUniformNames[i].size(), "uSamples[%d]", i);
+
+	mNoiseTex = std::make_shared<GPUResource::Texture>();
+	mSSAOParameters.ResizeNoiseScale(mDisplayManager->GetWidth(), mDisplayManager->GetHeight());
+	mSSAOParameters.GenerateNoiseTexture(mNoiseTex, mFrameArena, mJobPool);
+	mFrameArena.Reset();
+	//sample points 
+	//reserve max upfront, kernel size changes never reallocate
+	mSamplingKernelPoints.reserve(MAX_SSAO_KERNEL_SIZE);
+	mSSAOParameters.GenerateSamplePoint(mSamplingKernelPoints);
+	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &SSAO::ResizeNoiseScale, &mSSAOParameters);
+}
 
+void SSAOProgram::CreateDefaultScene()
+{
+	mGameObjects.clear();
+	mDynamicObjectCount = 0;
+	mShadowMap.InvalidateStatic();
+	bVisInstancesDirty = true;
 
 	//Scene object transformations
 	glm::mat4 mat = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f, 0.0f)) *
@@ -477,101 +833,422 @@ void SSAOProgram::InitSceneData()
 		//}
 
 	}
+}
 
-	////////////////////////////////////////
-	// UNIFORM BUFFERs
-	////////////////////////////////////////
-	//------------------Camera Matrix Data UBO-----------------------------/
-	long long int buf_size = sizeof(glm::vec3);//for view pos
-	buf_size += sizeof(float);// camera far
-	buf_size += 2 * sizeof(glm::mat4);// +sizeof(glm::vec2);   //to store view, projection
-	mCameraUBO.Generate(buf_size);
-	mCameraUBO.BindBufferRndIdx(0, buf_size, 0);
+void SSAOProgram::LoadDefaultScene()
+{
+	mMaterialBuffer.resize(mAuthoredMaterialCount);
+	RefreshMaterialList();
+	CreateDefaultScene();
+}
 
-	mDirLight.direction = glm::vec3(-1.0f, 1.0f, -0.2f);
+void SSAOProgram::LoadProceduralScene(const ProceduralSceneDesc& desc)
+{
+	mProceduralSceneDesc = desc;
+
+	//drop materials of a previous generated scene
+	mMaterialBuffer.resize(mAuthoredMaterialCount);
+	std::vector<ProceduralMaterialData> materials;
+	GenerateProceduralMaterials(desc, materials);
+	const size_t material_offset = mMaterialBuffer.size();
+	const size_t material_budget = (MAX_MATERIAL_BUFFER_SIZE > material_offset) ? MAX_MATERIAL_BUFFER_SIZE - material_offset : 0;
+	if (materials.size() > material_budget)
+		materials.resize(material_budget);
+	for (const auto& mat_data : materials)
+	{
+		auto new_mat = BaseMaterial();
+		new_mat.name = "Mat_Procedural";
+		new_mat.ambient = mat_data.ambient;
+		new_mat.diffuse = mat_data.diffuse;
+		new_mat.specular = mat_data.specular;
+		new_mat.shinness = mat_data.shininess;
+		mMaterialBuffer.push_back(std::make_shared<BaseMaterial>(new_mat));
+	}
+	RefreshMaterialList();
 
+	std::vector<ProceduralObject> objects;
+	GenerateProceduralScene(desc, objects);
 
-	mSSAOShader.Create("ssao shader", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/SSAO.frag");
-	mShaderHotReloaderTracker.AddShader(&mSSAOShader);
+	mGameObjects.clear();
+	mGameObjects.reserve(objects.size() + 1);
+	mDynamicObjectCount = 0;
+	mShadowMap.InvalidateStatic();
+	bVisInstancesDirty = true;
 
-	PGL_ASSERT_CRITICAL(mDisplayManager, "No Display Window to retrive screen dimension from");
-	GPUResource::TextureParameter render_target_para[4] =
+	//floor covering the scattered area
+	float floor_scale = std::max(50.0f, ProceduralSceneExtent(desc));
+	mGameObjects.push_back({ "Ground",
+							std::make_shared<RenderableMesh>(mMeshBuffer[1]),
+							mMaterialBuffer[0],
+							glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.1f, 0.0f)) *
+							glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
+							glm::scale(glm::mat4(1.0f), glm::vec3(floor_scale)) });
+
+	//one shared mesh per slot, not a copy per object
+	std::vector<std::shared_ptr<RenderableMesh>> slot_meshes;
+	slot_meshes.reserve(desc.meshSlots.size());
+	for (const auto& slot : desc.meshSlots)
+		slot_meshes.push_back(std::make_shared<RenderableMesh>(mMeshBuffer[slot.meshIdx]));
+
+	for (uint32_t i = 0; i < objects.size(); i++)
 	{
-		{GPUResource::IMGFormat::RGB16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
-		{GPUResource::IMGFormat::RGB16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
-		{GPUResource::IMGFormat::RGBA8, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
-		{GPUResource::IMGFormat::RGBA16F, GPUResource::TextureType::RENDER, GPUResource::TexWrapMode::CLAMP_EDGE, GPUResource::TexFilterMode::LINEAR, GPUResource::DataType::FLOAT, false, GPUResource::IMGFormat::RGBA},
-	};
-	mGBuffer_VS.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), 4, {}, render_target_para);
-	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::MultiRenderTarget::ResizeBuffer, &mGBuffer_VS);
-	mGeometryShader_VS.Create("scene geometry shader vs", "assets/shaders/AO/ViewSpaceGBuffer.vert", "assets/shaders/AO/ViewSpaceGBuffer.frag");
+		const auto& obj = objects[i];
+		size_t mat_idx = materials.empty() ? 1 : material_offset + obj.materialIdx % materials.size();
+		mGameObjects.push_back({ "", slot_meshes[obj.meshSlot], mMaterialBuffer[mat_idx], obj.transform });
+		snprintf(mGameObjects.back().name.data(), 56, "GameObject {Procedural} - %u", i);
+	}
+	DEBUG_LOG("Generated procedural scene: ", objects.size(), " objects, seed ", desc.seed);
+}
 
-	//world space buffer
-	mGBuffer_WS.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), 4, {}, render_target_para);
-	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::MultiRenderTarget::ResizeBuffer, &mGBuffer_WS);
-	mGeometryShader_WS.Create("scene geometry shader ws", "assets/shaders/AO/WorldSpaceGBuffer.vert", "assets/shaders/AO/WorldSpaceGBuffer.frag");
-	mShaderHotReloaderTracker.AddShader(&mGeometryShader_WS);
+void SSAOProgram::RunSceneScalingBenchmark(const char* csv_path)
+{
+	const uint32_t object_counts[] = { 1000, 10000, 100000 };
+	constexpr uint32_t warmup_frames = 10;
+	constexpr uint32_t measured_frames = 120;
+
+	//fixed pose, comparable across runs/releases
+	const float aspect_ratio = mDisplayManager->GetAspectRatio();
+	const glm::vec3 view_pos = glm::vec3(0.0f, 15.0f, 30.0f);
+	const FrameView frame_view = { view_pos, mCamera->mFar, mCamera->ProjMat(aspect_ratio),
+								   glm::lookAt(view_pos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) };
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : nullptr;
+	if (csv)
+		fprintf(csv, "objects,seed,submit_mean_ms,submit_p95_ms,frame_mean_ms,frame_p95_ms,scene_bytes,rss_bytes\n");
+	printf("[Scene Benchmark] seed %u, %u frames per case, G-buffer %s\n", mProceduralSceneDesc.seed, measured_frames,
+		   GBufferModeToStringArray()[static_cast<size_t>(mGBufferMode)]);
+	printf("[Scene Benchmark] %8s %12s %12s %12s %12s %12s %12s\n", "objects", "submit(ms)", "submit p95", "frame(ms)", "frame p95", "scene(KB)", "rss(MB)");
+
+	ProceduralSceneDesc desc = mProceduralSceneDesc;
+	for (uint32_t count : object_counts)
+	{
+		desc.objectCount = count;
+		LoadProceduralScene(desc);
 
-	//vert --> need to output screen size quad
-	//frag --> process the Guffer outputs with light data 
-	mGBufferDeferredLighting.Create("deffered lighting", PGL_ASSETS_PATH"/shaders/TextureToScreen.vert", "assets/shaders/AO/ViewSpaceDeferredLighting.frag");
-	mGBufferDeferredLighting.SetUniformBlockIdx("uCameraMat", 0);
-	mShaderHotReloaderTracker.AddShader(&mGBufferDeferredLighting);
+		for (uint32_t i = 0; i < warmup_frames; i++)
+		{
+			mFrameArena.Reset();
+			RenderFrame(frame_view);
+		}
+		glFinish();
 
-	GPUResource::TextureParameter fbo_tex_para =
+		Benchmark::TimingStats submit_stats;
+		Benchmark::TimingStats frame_stats;
+		submit_stats.Reserve(measured_frames);
+		frame_stats.Reserve(measured_frames);
+		for (uint32_t i = 0; i < measured_frames; i++)
+		{
+			double submit_ms = 0.0;
+			double frame_ms = 0.0;
+			{
+				Benchmark::ScopedTimer frame_timer(frame_ms);
+				{
+					Benchmark::ScopedTimer submit_timer(submit_ms);
+					mFrameArena.Reset();
+					RenderFrame(frame_view);
+				}
+				glFinish();
+			}
+			submit_stats.Add(submit_ms);
+			frame_stats.Add(frame_ms);
+		}
+
+		size_t scene_bytes = mGameObjects.capacity() * sizeof(GameObject);
+		size_t rss_bytes = Benchmark::GetProcessResidentBytes();
+		printf("[Scene Benchmark] %8u %12.3f %12.3f %12.3f %12.3f %12zu %12.1f\n", count,
+			   submit_stats.Mean(), submit_stats.Percentile(95.0), frame_stats.Mean(), frame_stats.Percentile(95.0),
+			   scene_bytes / 1024, static_cast<double>(rss_bytes) / (1024.0 * 1024.0));
+		if (csv)
+			fprintf(csv, "%u,%u,%.4f,%.4f,%.4f,%.4f,%zu,%zu\n", count, desc.seed,
+					submit_stats.Mean(), submit_stats.Percentile(95.0), frame_stats.Mean(), frame_stats.Percentile(95.0),
+					scene_bytes, rss_bytes);
+	}
+	if (csv)
+		fclose(csv);
+}
+
+void SSAOProgram::LoadLocalLights(uint32_t count, uint32_t seed)
+{
+	mLocalLightCount = static_cast<int>(count);
+	mLocalLightSeed = seed;
+	//spread over the generated scene area, default scene sits well inside it
+	GenerateLocalLights(count, seed, std::max(20.0f, ProceduralSceneExtent(mProceduralSceneDesc)), mLocalLights);
+}
+
+void SSAOProgram::RunLightingBenchmark(const char* csv_path)
+{
+	const uint32_t light_counts[] = { 16, 256, 4096 };
+	constexpr uint32_t warmup_frames = 10;
+	constexpr uint32_t measured_frames = 120;
+
+	const float aspect_ratio = mDisplayManager->GetAspectRatio();
+	const glm::vec3 view_pos = glm::vec3(0.0f, 6.0f, 14.0f);
+	const FrameView frame_view = { view_pos, mCamera->mFar, mCamera->ProjMat(aspect_ratio),
+								   glm::lookAt(view_pos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) };
+
+	const bool prev_clustered = bClusteredLighting;
+	const uint32_t prev_light_count = static_cast<uint32_t>(mLocalLightCount);
+	bClusteredLighting = true;
+
+	GPUTimer& lighting_timer = mGPUTimers[static_cast<size_t>(EGPUPass::LIGHTING)];
+	FILE* csv = csv_path ? fopen(csv_path, "w") : nullptr;
+	if (csv)
+		fprintf(csv, "lights,seed,cull_mean_ms,cull_p95_ms,lighting_gpu_mean_ms,lighting_gpu_p95_ms,frame_mean_ms,frame_p95_ms,light_indices,max_per_cluster,overflow\n");
+	printf("[Light Benchmark] seed %u, %u worker threads, %u frames per case\n", mLocalLightSeed, mJobPool.GetThreadCount(), measured_frames);
+	printf("[Light Benchmark] %6s %10s %10s %12s %12s %10s %10s %10s %10s\n", "lights", "cull(ms)", "cull p95", "light gpu", "light p95", "frame(ms)", "indices", "max/clstr", "dropped");
+
+	for (uint32_t count : light_counts)
 	{
-		//GPUResource::IMGFormat::R16F,
-		GPUResource::IMGFormat::RED,
-		GPUResource::TextureType::RENDER,
-		GPUResource::TexWrapMode::CLAMP_EDGE,
-		GPUResource::TexFilterMode::NEAREST,
-		GPUResource::DataType::FLOAT,
-		false,
-		GPUResource::IMGFormat::RED
-	};
-	mSSAOFBO.Generate(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), { false }, fbo_tex_para);
-	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &GPUResource::Framebuffer::ResizeBuffer2, &mSSAOFBO);
+		LoadLocalLights(count, mLocalLightSeed);
+		for (uint32_t i = 0; i < warmup_frames; i++)
+		{
+			mFrameArena.Reset();
+			RenderFrame(frame_view);
+		}
+		glFinish();
+
+		Benchmark::TimingStats cull_stats;
+		Benchmark::TimingStats lighting_stats;
+		Benchmark::TimingStats frame_stats;
+		cull_stats.Reserve(measured_frames);
+		lighting_stats.Reserve(measured_frames);
+		frame_stats.Reserve(measured_frames);
+		for (uint32_t i = 0; i < measured_frames; i++)
+		{
+			double frame_ms = 0.0;
+			{
+				Benchmark::ScopedTimer frame_timer(frame_ms);
+				mFrameArena.Reset();
+				RenderFrame(frame_view);
+				glFinish();
+			}
+			cull_stats.Add(mLightCuller.GetLastBuildMs());
+			lighting_stats.Add(lighting_timer.ResolveLatestMs());
+			frame_stats.Add(frame_ms);
+		}
 
-	////////////////////
-	//SSAO Datas 
-	////////////////////
-	//Noise generation per pixel data 
-	std::vector<glm::vec3> noise_vector;
-	auto randomf = Util::Random::RNG<float>(Util::Random::rnd_b4mt, -1.0f, 1.0f);
-	for (uint16_t i = 0; i < 16; i++)
+		printf("[Light Benchmark] %6u %10.3f %10.3f %12.3f %12.3f %10.3f %10u %10u %10u\n", count,
+			   cull_stats.Mean(), cull_stats.Percentile(95.0), lighting_stats.Mean(), lighting_stats.Percentile(95.0),
+			   frame_stats.Mean(), mLightCuller.GetTotalLightIndices(), mLightCuller.GetMaxLightsInCluster(), mLightCuller.GetOverflowCount());
+		//timings undercount the shading cost once lists are truncated
+		if (mLightCuller.GetOverflowCount() > 0)
+			printf("[Light Benchmark] WARNING: %u lights => full clusters (cap %u), %u light/cluster pairs not shaded, timings are not comparable\n",
+				   count, MAX_LIGHTS_PER_CLUSTER, mLightCuller.GetOverflowCount());
+		if (csv)
+			fprintf(csv, "%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u\n", count, mLocalLightSeed,
+					cull_stats.Mean(), cull_stats.Percentile(95.0), lighting_stats.Mean(), lighting_stats.Percentile(95.0),
+					frame_stats.Mean(), frame_stats.Percentile(95.0),
+					mLightCuller.GetTotalLightIndices(), mLightCuller.GetMaxLightsInCluster(), mLightCuller.GetOverflowCount());
+	}
+	if (csv)
+		fclose(csv);
+
+	bClusteredLighting = prev_clustered;
+	LoadLocalLights(prev_light_count, mLocalLightSeed);
+}
+
+void SSAOProgram::UpdateUBOs(const FrameView& view)
+{
+	mUniformRing.BeginFrame();
+
+	CameraBlock camera_block = { view.position, view.far, view.proj, view.view };
+	size_t offset = mUniformRing.Write(camera_block);
+	mUniformRing.BindRange(CAMERA_UBO_BINDING, offset, sizeof(CameraBlock));
+
+	FrameParamsBlock frame_params;
+	frame_params.projection = view.proj;
+	frame_params.lightDirection = glm::vec4(mDirLight.direction, mDirLight.base.enable ? 1.0f : 0.0f);
+	frame_params.lightDiffuse = glm::vec4(mDirLight.base.diffuse, 0.0f);
+	frame_params.lightSpecular = glm::vec4(mDirLight.base.specular, 0.0f);
+	frame_params.aoParams = glm::vec4(mSSAOParameters.sampleRadius, mSSAOParameters.bias, mSSAOParameters.power, mSSAOParameters.resolutionScale);
+	//one noise texel per SSAO texel at any resolution scale
+	frame_params.noiseScale = glm::vec4(mSSAOParameters.noiseScale * mSSAOParameters.resolutionScale, 0.0f, 0.0f);
+	frame_params.aoSettings = glm::ivec4(mSSAOParameters.kernelSize, (mEAOSampleType == EAOSampleType::WS_SAMPLE),
+										 mSSAOParameters.GetEffectiveSampleCount(), mSSAOParameters.blurRadius);
+	frame_params.lightingFlags = glm::ivec4(mSSAOParameters.bShadingEnable, mSSAOParameters.bBlurEnable, bOnlyRenderAONoLighting, bAdaptiveSSAO && bSSAOHeatmap);
+	const float cluster_near = mLightCuller.GetNear();
+	frame_params.clusterParams = glm::vec4(cluster_near, std::log(mLightCuller.GetFar() / cluster_near), static_cast<float>(mLightCuller.GetLightCount()), 0.0f);
+	frame_params.clusterSettings = glm::ivec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, bClusteredLighting);
+	offset = mUniformRing.Write(frame_params);
+	mUniformRing.BindRange(FRAME_PARAMS_UBO_BINDING, offset, sizeof(FrameParamsBlock));
+
+	ShadowParamsBlock shadow_params;
+	mShadowMap.FillShadowParams(shadow_params, glm::inverse(view.view), bShadowsEnabled && mDirLight.base.enable);
+	offset = mUniformRing.Write(shadow_params);
+	mUniformRing.BindRange(SHADOW_PARAMS_UBO_BINDING, offset, sizeof(ShadowParamsBlock));
+}
+
+void SSAOProgram::RenderShadowPass(const FrameView& view)
+{
+	if (!bShadowsEnabled || !mDirLight.base.enable)
+		return;
+
+	mShadowMap.Update(view.view, view.proj, mDirLight.direction);
+	bool any_static = false;
+	for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT && !any_static; c++)
+		any_static = mShadowMap.NeedsStaticRender(c);
+	//steady state with no dynamic casters => nothing to draw, the cached atlas is sampled as is
+	if (!any_static && mDynamicObjectCount == 0)
+		return;
+
+	ScopedGPUTimer gpu_timer(mGPUTimers[static_cast<size_t>(EGPUPass::SHADOW)]);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+	mShadowDepthShader.Bind();
+	for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++)
 	{
-		glm::vec3 noise(randomf(), randomf(), 0.0f);
-		noise_vector.push_back(noise);
+		if (!mShadowMap.NeedsStaticRender(c))
+			continue;
+		mShadowMap.BeginStaticCascade(c);
+		mShadowDepthShader.SetUniformMat4("uLightSpaceMat", mShadowMap.GetLightViewProj(c));
+		DrawShadowCasters(mShadowDepthShader, false);
 	}
+	if (mDynamicObjectCount > 0)
+	{
+		mShadowMap.BeginDynamicPass();
+		for (uint32_t c = 0; c < SHADOW_CASCADE_COUNT; c++)
+		{
+			mShadowMap.SetCascadeViewport(c);
+			mShadowDepthShader.SetUniformMat4("uLightSpaceMat", mShadowMap.GetLightViewProj(c));
+			DrawShadowCasters(mShadowDepthShader, true);
+		}
+	}
+	mShadowMap.EndPass();
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glEnable(GL_CULL_FACE);
+}
 
-	//Best SSAO 
-	mSSAOParameters.power = 1.0f; // 3.05f;
-	mSSAOParameters.sampleRadius = 0.5f; // 2.38f;
-	mSSAOParameters.bias = 0.025f; // 0.622f;
-	//default value
-	//mSSAOParameters.noiseSize = 4;
-	//mSSAOParameters.kernelSize = 64;
-	//mSSAOParameters.screenWidth = 1920;
-	//mSSAOParameters.screenHeigth = 1080;
-	//mSSAOParameters.noiseScale = glm::vec2(1920.0f / 4.0f, 1080.0f / 4.0f);
+void SSAOProgram::RenderVisibilityPass()
+{
+	ScopedGPUTimer gpu_timer(mGPUTimers[static_cast<size_t>(EGPUPass::VISIBILITY)]);
 
-	mNoiseTex = std::make_shared<GPUResource::Texture>();
-	mSSAOParameters.GenerateNoiseTexture(mNoiseTex);
-	//sample points 
-	mSSAOParameters.GenerateSamplePoint(mSamplingKernelPoints);
-	REGISTER_RESIZE_CALLBACK_HELPER((*mDisplayManager), &SSAO::ResizeNoiseScale, &mSSAOParameters);
+	//instance => material table, only rebuilt with the scene
+	if (bVisInstancesDirty)
+	{
+		mVisInstanceMaterials.resize(mGameObjects.size());
+		for (size_t i = 0; i < mGameObjects.size(); i++)
+		{
+			const BaseMaterial* mat = mGameObjects[i].ptrMaterial.lock().get();
+			auto it = std::find_if(mMaterialBuffer.begin(), mMaterialBuffer.end(), [mat](const auto& m) { return m.get() == mat; });
+			mVisInstanceMaterials[i] = (it != mMaterialBuffer.end()) ? static_cast<uint32_t>(it - mMaterialBuffer.begin()) : 0;
+		}
+		mVisBuffer.UploadInstanceMaterials(mVisInstanceMaterials);
+		bVisInstancesDirty = false;
+	}
+	//material table is tiny, re-upload so editor changes show
+	const uint32_t material_count = static_cast<uint32_t>(std::min<size_t>(mMaterialBuffer.size(), mVisMaterials.size()));
+	for (uint32_t i = 0; i < material_count; i++)
+	{
+		const BaseMaterial& mat = *mMaterialBuffer[i];
+		mVisMaterials[i] = { glm::vec4(mat.diffuse, 0.0f), glm::vec4(mat.ambient, 0.0f), glm::vec4(mat.specular, mat.shinness) };
+	}
+	mVisBuffer.UploadMaterials(mVisMaterials.data(), material_count);
+
+	mVisBuffer.Bind();
+	ScopedGPUQuery<GPUSampleCounter> samples(mGeometrySamples);
+	mVisibilityShader.Bind();
+	const uint32_t instance_count = static_cast<uint32_t>(std::min<size_t>(mGameObjects.size(), VIS_MAX_INSTANCES));
+	for (uint32_t i = 0; i < instance_count; i++)
+	{
+		const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh, bdynamic] = mGameObjects[i];
+		mVisibilityShader.SetUniformMat4("uModel", trans);
+		if (mesh_ptr && !bmulti_mesh)
+		{
+			mVisibilityShader.SetUniform1i("uInstanceID", static_cast<int>(i));
+			mesh_ptr->Draw();
+		}
+		else
+		{
+			//sub mesh in the top bits, keeps triangle ids of different meshes apart
+			for (uint32_t m = 0; m < multi_mesh.size(); m++)
+			{
+				uint32_t sub_mesh = std::min<uint32_t>(m, (1u << VIS_SUBMESH_BITS) - 1);
+				mVisibilityShader.SetUniform1i("uInstanceID", static_cast<int>(i | (sub_mesh << (32 - VIS_SUBMESH_BITS))));
+				multi_mesh[m].Draw();
+			}
+		}
+	}
+	mVisBuffer.UnBind();
+}
+
+void SSAOProgram::RenderGBuffer(GPUResource::MultiRenderTarget& gbuffer, Shader& geometry_shader, EGPUPass pass, bool world_space)
+{
+	ScopedGPUTimer gpu_timer(mGPUTimers[static_cast<size_t>(pass)]);
+	//overdraw is measured on the view space G-buffer, the world space one draws the same geometry
+	const bool measure = !world_space;
+
+	gbuffer.Bind();
+	glClearColor(mClearColour.r, mClearColour.g, mClearColour.b, mClearColour.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	switch (mGBufferMode)
+	{
+	case EGBufferMode::DIRECT:
+		if (measure)
+			mGeometrySamples.Begin();
+		DrawScene(geometry_shader, true);
+		if (measure)
+			mGeometrySamples.End();
+		break;
+	case EGBufferMode::DEPTH_PREPASS:
+		//depth only, then shade exactly the visible surface
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		if (measure)
+			mPrepassSamples.Begin();
+		DrawScene(mDepthPrepassShader);
+		if (measure)
+			mPrepassSamples.End();
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+		if (measure)
+			mGeometrySamples.Begin();
+		DrawScene(geometry_shader, true);
+		if (measure)
+			mGeometrySamples.End();
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LEQUAL);
+		break;
+	case EGBufferMode::VISIBILITY_BUFFER:
+		mVisibilityResolveShader.Bind();
+		mVisibilityResolveShader.SetUniform1i("uWorldSpace", world_space);
+		mVisBuffer.BindTextures(0, 1);
+		mVisBuffer.BindBuffers();
+		if (measure)
+			mResolveSamples.Begin();
+		mMeshBuffer[1].Draw();
+		if (measure)
+			mResolveSamples.End();
+		break;
+	default:
+		break;
+	}
+	gbuffer.UnBind();
+}
+
+void SSAOProgram::DrawShadowCasters(Shader& shader, bool dynamic)
+{
+	for (const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh, bdynamic] : mGameObjects)
+	{
+		if (bdynamic != dynamic)
+			continue;
+		shader.SetUniformMat4("uModel", trans);
+		if (mesh_ptr && !bmulti_mesh)
+			mesh_ptr->Draw();
+		else
+		{
+			for (auto& m : multi_mesh)
+				m.Draw();
+		}
+	}
 }
 
-void SSAOProgram::UpdateUBOs(EditorCamera& cam, float aspect_ratio)
+void SSAOProgram::RefreshDynamicObjectCount()
 {
-	unsigned int offset_ptr = 0;
-	mCameraUBO.SetSubDataByID(&(cam.GetPosition()[0]), sizeof(glm::vec3), offset_ptr);
-	offset_ptr += sizeof(glm::vec3);
-	mCameraUBO.SetSubDataByID(&cam.mFar, sizeof(float), offset_ptr);
-	offset_ptr += sizeof(float);
-	mCameraUBO.SetSubDataByID(&(cam.ProjMat(aspect_ratio)[0][0]), sizeof(glm::mat4), offset_ptr);
-	offset_ptr += sizeof(glm::mat4);
-	mCameraUBO.SetSubDataByID(&(cam.ViewMat()[0][0]), sizeof(glm::mat4), offset_ptr);
+	mDynamicObjectCount = 0;
+	for (const auto& obj : mGameObjects)
+		mDynamicObjectCount += obj.isDynamic ? 1 : 0;
 }
 
 void SSAOProgram::DrawScene(Shader& shader, bool apply_material)
@@ -579,10 +1256,15 @@ void SSAOProgram::DrawScene(Shader& shader, bool apply_material)
 	shader.Bind();
 	if (apply_material)
 	{
-		for (const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh] : mGameObjects)
+		//objects sharing a material skip the re-upload, one lock per object (no expired() + lock())
+		const BaseMaterial* last_mat = nullptr;
+		for (const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh, bdynamic] : mGameObjects)
 		{
-			if (!mat_ptr.expired())
-				MaterialShaderHelper(shader, *mat_ptr.lock());
+			if (auto mat = mat_ptr.lock(); mat && mat.get() != last_mat)
+			{
+				MaterialShaderHelper(shader, *mat);
+				last_mat = mat.get();
+			}
 			shader.SetUniformMat4("uModel", trans);
 			if (mesh_ptr && !bmulti_mesh)
 				mesh_ptr->Draw();
@@ -595,7 +1277,7 @@ void SSAOProgram::DrawScene(Shader& shader, bool apply_material)
 	}
 	else
 	{
-		for (const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh] : mGameObjects)
+		for (const auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh, bdynamic] : mGameObjects)
 		{
 			shader.SetUniformMat4("uModel", trans);
 			if (mesh_ptr && !bmulti_mesh)
@@ -609,6 +1291,131 @@ void SSAOProgram::DrawScene(Shader& shader, bool apply_material)
 	}
 }
 
+void SSAOProgram::RefreshMaterialList()
+{
+	mMaterialList.clear();
+	mMaterialList.reserve(mMaterialBuffer.size());
+	for (auto& m : mMaterialBuffer)
+		mMaterialList.push_back(m);
+}
+
+bool SSAOProgram::RunSteadyStateAllocationCheck(uint32_t warmup_frames, uint32_t test_frames)
+{
+	if (!FrameMemory::AllocationTracker::IsInstrumented())
+	{
+		printf("[Alloc Check] Not instrumented, rebuild with -DAO_TRACK_HEAP_ALLOCATIONS=ON\n");
+		return false;
+	}
+
+	FrameMemory::AllocationTracker::SetSteadyStateWarmupFrames(warmup_frames);
+	FrameMemory::AllocationTracker::ResetSteadyStateViolations();
+	constexpr float fixed_delta = 1.0f / 60.0f;
+	//no app loop here, the UI path is driven directly (ImGui frame without a render) so editors are checked as well
+	ImGuiIO& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(static_cast<float>(mDisplayManager->GetWidth()), static_cast<float>(mDisplayManager->GetHeight()));
+	io.DeltaTime = fixed_delta;
+	if (!io.Fonts->IsBuilt())
+		io.Fonts->Build();
+	for (uint32_t i = 0; i < warmup_frames + test_frames; i++)
+	{
+		OnUpdate(fixed_delta);
+		ImGui::NewFrame();
+		OnUI();
+		ImGui::EndFrame();
+
+		const auto& frame = FrameMemory::AllocationTracker::GetLastFrameStats();
+		if (i < warmup_frames || frame.allocCount == 0)
+			continue;
+		printf("[Alloc Check] Frame %u allocated %u times (%llu bytes)\n", i, frame.allocCount, static_cast<unsigned long long>(frame.allocBytes));
+		const auto& passes = FrameMemory::AllocationTracker::GetLastFramePassStats();
+		for (size_t p = 0; p < FrameMemory::AllocationTracker::GetLastFramePassCount(); p++)
+		{
+			if (passes[p].allocCount > 0)
+				printf("[Alloc Check]     %s: %u (%llu bytes)\n", passes[p].name, passes[p].allocCount, static_cast<unsigned long long>(passes[p].allocBytes));
+		}
+	}
+	glFinish();
+
+	uint64_t violations = FrameMemory::AllocationTracker::GetSteadyStateViolationCount();
+	printf("[Alloc Check] %s: %llu of %u steady state frames allocated\n", (violations == 0) ? "PASSED" : "FAILED",
+		   static_cast<unsigned long long>(violations), test_frames);
+	return violations == 0;
+}
+
+AOBatchStats SSAOProgram::RunAOBatch(const std::vector<AOBatchPose>& poses, const std::string& output_dir, uint32_t ring_depth)
+{
+	AOBatchStats stats;
+	stats.viewCount = static_cast<uint32_t>(poses.size());
+
+	//same intrinsics as the interactive camera for every pose
+	const float aspect_ratio = mDisplayManager->GetAspectRatio();
+	FrameView frame_view = { glm::vec3(0.0f), mCamera->mFar, mCamera->ProjMat(aspect_ratio), glm::mat4(1.0f) };
+
+	//whole target every view, a scaled or tiled SSAO pass leaves parts of the read back image stale
+	const float prev_resolution_scale = mSSAOParameters.resolutionScale;
+	const bool prev_adaptive = bAdaptiveSSAO;
+	mSSAOParameters.resolutionScale = 1.0f;
+	bAdaptiveSSAO = false;
+
+	AOBatchReadback readback(ring_depth);
+	readback.Begin(mDisplayManager->GetWidth(), mDisplayManager->GetHeight(), output_dir);
+
+	glFinish();
+	auto batch_start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < stats.viewCount; i++)
+	{
+		auto render_start = std::chrono::high_resolution_clock::now();
+		mFrameArena.Reset();
+		frame_view.position = poses[i].position;
+		frame_view.view = glm::lookAt(poses[i].position, poses[i].target, glm::vec3(0.0f, 1.0f, 0.0f));
+		RenderFrame(frame_view);
+		stats.renderSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - render_start).count();
+
+		mSSAOFBO.Bind();
+		readback.Capture(i);
+		mSSAOFBO.UnBind();
+	}
+	readback.Finish();
+	stats.totalSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - batch_start).count();
+	stats.readbackWaitSeconds = readback.GetReadbackWaitSeconds();
+	stats.failedReadbacks = readback.GetFailedReadbackCount();
+	mSSAOParameters.resolutionScale = prev_resolution_scale;
+	bAdaptiveSSAO = prev_adaptive;
+
+	printf("[AO Batch] %u views in %.3fs => %.2f views/s (render %.3fms/view, readback wait %.3fms/view)\n",
+		   stats.viewCount, stats.totalSeconds, stats.ViewsPerSecond(),
+		   stats.viewCount ? 1000.0 * stats.renderSeconds / stats.viewCount : 0.0,
+		   stats.viewCount ? 1000.0 * stats.readbackWaitSeconds / stats.viewCount : 0.0);
+	if (stats.failedReadbacks > 0)
+		printf("[AO Batch] %u / %u views failed to read back & were not written\n", stats.failedReadbacks, stats.viewCount);
+	return stats;
+}
+
+void SSAOProgram::RunAOBatchBenchmark(uint32_t view_count)
+{
+	std::vector<AOBatchPose> poses;
+	GenerateOrbitAOBatchPoses(view_count, glm::vec3(0.0f, 0.5f, 0.0f), 12.0f, 6.0f, poses);
+
+	//warm up (shader compile/driver lazy allocs) outside of the measurements
+	RunAOBatch(std::vector<AOBatchPose>(poses.begin(), poses.begin() + std::min<size_t>(poses.size(), 8)), "", 1);
+
+	struct BenchCase { const char* label; uint32_t ringDepth; const char* outputDir; };
+	const BenchCase bench_cases[] =
+	{
+		{ "sync readback", 1, "" },
+		{ "PBO ring x3", 3, "" },
+		{ "PBO ring x3 + writers", 3, "ao_batch_bench" },
+	};
+
+	printf("[AO Batch Benchmark] %u views @ %ux%u, G-buffer %s\n", view_count, mDisplayManager->GetWidth(), mDisplayManager->GetHeight(),
+		   GBufferModeToStringArray()[static_cast<size_t>(mGBufferMode)]);
+	for (const auto& bench : bench_cases)
+	{
+		AOBatchStats stats = RunAOBatch(poses, bench.outputDir, bench.ringDepth);
+		printf("[AO Batch Benchmark] %-24s %8.2f views/s\n", bench.label, stats.ViewsPerSecond());
+	}
+}
+
 void SSAOProgram::MaterialShaderHelper(Shader& shader, const BaseMaterial& mat)
 {
 	//Material (u_Material)
@@ -629,33 +1436,558 @@ void SSAOProgram::GameObjectsInspectorEditor(std::vector<GameObject>& game_objec
 	{
 		if (ImGui::Begin("GameObject Inspector", &p_open_flag))
 		{
-			for (auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh] : game_objects)
+			//only the visible rows are built, stays cheap with large generated scenes
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(game_objects.size()));
+			while (clipper.Step())
 			{
-				ImGui::PushID(&mesh_ptr);
-				ImGui::Separator();
-				ImGui::Text(name.data());
-				ImGui::InputText("Name", name.data(), name.size());
-
-				auto& translate = trans[3];
-				ImGui::DragFloat3("Translation", &translate[0], 0.01f, (0.0f), (0.0f), "%.2f");
-
-				glm::vec3 euler;
-				glm::vec3 scale;
-				Util::DecomposeTransform(trans, glm::vec3(), euler, scale);
-				bool update = ImGui::DragFloat3("Euler", &euler[0], 0.01f, (0.0f), (0.0f), "%.2f");
-				update |= ImGui::DragFloat3("Scale", &scale[0], 0.01f, (0.0f), (0.0f), "%.2f");
-				if (update)
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 				{
-					trans = glm::translate(glm::mat4(1.0f), static_cast<glm::vec3>(translate)) *
-						//glm::toMat4(glm::quat(glm::radians(euler))) *
-						//glm::mat4_cast(glm::quat(glm::radians(euler))) *
-						glm::scale(glm::mat4(1.0f), scale);
-					DEBUG_LOG("Euler as degree: ", euler);
-					DEBUG_LOG("Euler as radian: ", glm::radians(euler));
+					auto& [name, mesh_ptr, mat_ptr, trans, bmulti_mesh, multi_mesh, bdynamic] = game_objects[i];
+					ImGui::PushID(&mesh_ptr);
+					ImGui::Separator();
+					ImGui::Text(name.data());
+					ImGui::InputText("Name", name.data(), name.size());
+
+					auto& translate = trans[3];
+					bool update = ImGui::DragFloat3("Translation", &translate[0], 0.01f, (0.0f), (0.0f), "%.2f");
+
+					glm::vec3 euler;
+					glm::vec3 scale;
+					Util::DecomposeTransform(trans, glm::vec3(), euler, scale);
+					update |= ImGui::DragFloat3("Euler", &euler[0], 0.01f, (0.0f), (0.0f), "%.2f");
+					update |= ImGui::DragFloat3("Scale", &scale[0], 0.01f, (0.0f), (0.0f), "%.2f");
+					if (ImGui::Checkbox("Dynamic (shadow)", &bdynamic))
+					{
+						RefreshDynamicObjectCount();
+						mShadowMap.InvalidateStatic();
+					}
+					if (update)
+					{
+						//moving a static caster re-renders the cached shadow cascades
+						if (!bdynamic)
+							mShadowMap.InvalidateStatic();
+						trans = glm::translate(glm::mat4(1.0f), static_cast<glm::vec3>(translate)) *
+							//glm::toMat4(glm::quat(glm::radians(euler))) *
+							//glm::mat4_cast(glm::quat(glm::radians(euler))) *
+							glm::scale(glm::mat4(1.0f), scale);
+						DEBUG_LOG("Euler as degree: ", euler);
+						DEBUG_LOG("Euler as radian: ", glm::radians(euler));
+					}
+
+					ImGui::PopID();
 				}
+			}
+		}
+		ImGui::End();
+	}
+}
 
+void SSAOProgram::FrameAllocationsEditor()
+{
+	HELPER_REGISTER_UIFLAG("Frame Allocations", p_open_flag, false);
+	if (p_open_flag)
+	{
+		if (ImGui::Begin("Frame Allocations", &p_open_flag))
+		{
+			if (!FrameMemory::AllocationTracker::IsInstrumented())
+				ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Heap hook off, build with AO_TRACK_HEAP_ALLOCATIONS");
+
+			ImGui::SeparatorText("Frame Arena");
+			ImGui::Text("Used: %zu / %zu bytes", mFrameArena.GetUsed(), mFrameArena.GetCapacity());
+			ImGui::Text("High water mark: %zu bytes", mFrameArena.GetHighWaterMark());
+			ImGui::Text("Overflows: %u", mFrameArena.GetOverflowCount());
+
+			ImGui::SeparatorText("Uniform Ring");
+			ImGui::Text("Persistently mapped: %s", mUniformRing.IsPersistentlyMapped() ? "yes" : "no (glBufferSubData fallback)");
+			ImGui::Text("Fence stalls: %llu", static_cast<unsigned long long>(mUniformRing.GetStallCount()));
+
+			ImGui::SeparatorText("Heap");
+			const auto& frame = FrameMemory::AllocationTracker::GetLastFrameStats();
+			ImGui::Text("Frame %llu: %u allocs, %llu bytes", static_cast<unsigned long long>(FrameMemory::AllocationTracker::GetFrameIndex()),
+						frame.allocCount, static_cast<unsigned long long>(frame.allocBytes));
+			ImGui::Text("Steady state violations: %llu", static_cast<unsigned long long>(FrameMemory::AllocationTracker::GetSteadyStateViolationCount()));
+			const auto& passes = FrameMemory::AllocationTracker::GetLastFramePassStats();
+			for (size_t i = 0; i < FrameMemory::AllocationTracker::GetLastFramePassCount(); i++)
+				ImGui::Text("    %-20s %6u allocs %10llu bytes", passes[i].name, passes[i].allocCount, static_cast<unsigned long long>(passes[i].allocBytes));
+		}
+		ImGui::End();
+	}
+}
+
+void SSAOProgram::SceneGeneratorEditor()
+{
+	HELPER_REGISTER_UIFLAG("Scene Generator", p_open_flag, false);
+	if (p_open_flag)
+	{
+		if (ImGui::Begin("Scene Generator", &p_open_flag))
+		{
+			ImGui::Text("Game objects: %zu", mGameObjects.size());
+
+			int seed = static_cast<int>(mProceduralSceneDesc.seed);
+			if (ImGui::InputInt("Seed", &seed))
+				mProceduralSceneDesc.seed = static_cast<uint32_t>(seed);
+			int object_count = static_cast<int>(mProceduralSceneDesc.objectCount);
+			if (ImGui::DragInt("Object count", &object_count, 100.0f, 1, 200000))
+				mProceduralSceneDesc.objectCount = static_cast<uint32_t>(object_count);
+			ImGui::SliderFloat("Density", &mProceduralSceneDesc.density, 0.01f, 4.0f, "%.2f");
+			ImGui::SliderFloat("Min scale", &mProceduralSceneDesc.minScale, 0.1f, 2.0f, "%.2f");
+			ImGui::SliderFloat("Max scale", &mProceduralSceneDesc.maxScale, 0.1f, 4.0f, "%.2f");
+			int variety = static_cast<int>(mProceduralSceneDesc.materialVariety);
+			if (ImGui::SliderInt("Material variety", &variety, 1, MAX_MATERIAL_BUFFER_SIZE - static_cast<int>(mAuthoredMaterialCount)))
+				mProceduralSceneDesc.materialVariety = static_cast<uint32_t>(variety);
+
+			ImGui::SeparatorText("Mesh weights");
+			for (auto& slot : mProceduralSceneDesc.meshSlots)
+			{
+				ImGui::PushID(&slot);
+				ImGui::SliderFloat("Weight", &slot.weight, 0.0f, 1.0f, "%.2f");
+				ImGui::SameLine();
+				ImGui::Text("mesh %u", slot.meshIdx);
 				ImGui::PopID();
 			}
+
+			if (ImGui::Button("Generate"))
+				LoadProceduralScene(mProceduralSceneDesc);
+			ImGui::SameLine();
+			if (ImGui::Button("Default scene"))
+				LoadDefaultScene();
+		}
+		ImGui::End();
+	}
+}
+
+void SSAOProgram::LocalLightsEditor()
+{
+	HELPER_REGISTER_UIFLAG("Local Lights", p_open_flag, false);
+	if (p_open_flag)
+	{
+		if (ImGui::Begin("Local Lights", &p_open_flag))
+		{
+			ImGui::Checkbox("Clustered lighting", &bClusteredLighting);
+			int seed = static_cast<int>(mLocalLightSeed);
+			if (ImGui::InputInt("Seed", &seed))
+				mLocalLightSeed = static_cast<uint32_t>(seed);
+			ImGui::DragInt("Light count", &mLocalLightCount, 4.0f, 0, MAX_LOCAL_LIGHTS);
+			if (ImGui::Button("Generate"))
+				LoadLocalLights(static_cast<uint32_t>(mLocalLightCount), mLocalLightSeed);
+
+			ImGui::SeparatorText("Clusters");
+			ImGui::Text("Grid: %u x %u x %u (%u clusters)", CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, CLUSTER_COUNT);
+			ImGui::Text("Depth range: %.2f - %.2f", mLightCuller.GetNear(), mLightCuller.GetFar());
+			ImGui::Text("Lights: %u, job threads: %u", mLightCuller.GetLightCount(), mJobPool.GetThreadCount());
+			ImGui::Text("CPU build: %.3f ms", mLightCuller.GetLastBuildMs());
+			ImGui::Text("Light indices: %u, max per cluster: %u", mLightCuller.GetTotalLightIndices(), mLightCuller.GetMaxLightsInCluster());
+			if (mLightCuller.GetOverflowCount() > 0)
+				ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Dropped: %u (cluster full)", mLightCuller.GetOverflowCount());
+
+			ImGui::SeparatorText("GPU passes");
+			auto pass_names = GPUPassToStringArray();
+			for (size_t i = 0; i < mGPUTimers.size(); i++)
+				ImGui::Text("%-12s %.3f ms", pass_names[i], mGPUTimers[i].GetLastMs());
+		}
+		ImGui::End();
+	}
+}
+
+void SSAOProgram::OverdrawEditor()
+{
+	HELPER_REGISTER_UIFLAG("G-Buffer Overdraw", p_open_flag, false);
+	if (p_open_flag)
+	{
+		if (ImGui::Begin("G-Buffer Overdraw", &p_open_flag))
+		{
+			int mode = static_cast<int>(mGBufferMode);
+			auto mode_string_array = GBufferModeToStringArray();
+			if (ImGui::Combo("G-buffer mode", &mode, mode_string_array.data(), mode_string_array.size()))
+				mGBufferMode = static_cast<EGBufferMode>(mode);
+			if (mGBufferMode == EGBufferMode::VISIBILITY_BUFFER)
+				ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Approximation: flat face normals, not comparable to DIRECT");
+
+			//MRT => 2 x RGB16F + RGBA8 + RGBA16F, visibility => RG32UI
+			constexpr double mrt_bytes = 6.0 + 6.0 + 4.0 + 8.0;
+			constexpr double vis_bytes = 8.0;
+			const double pixels = static_cast<double>(mDisplayManager->GetWidth()) * mDisplayManager->GetHeight();
+			const double to_mb = 1.0 / (1024.0 * 1024.0);
+			auto per_pixel = [pixels](uint64_t samples) { return (pixels > 0.0) ? static_cast<double>(samples) / pixels : 0.0; };
+
+			ImGui::SeparatorText("View space G-buffer (last frame)");
+			ImGui::Text("Screen pixels: %.0f", pixels);
+			const uint64_t geometry = mGeometrySamples.GetLastResult();
+			switch (mGBufferMode)
+			{
+			case EGBufferMode::DIRECT:
+				ImGui::Text("MRT fragments: %llu (%.2f per pixel)", static_cast<unsigned long long>(geometry), per_pixel(geometry));
+				ImGui::Text("MRT colour writes: %.2f MB", geometry * mrt_bytes * to_mb);
+				break;
+			case EGBufferMode::DEPTH_PREPASS:
+			{
+				const uint64_t prepass = mPrepassSamples.GetLastResult();
+				ImGui::Text("Pre-pass depth fragments: %llu (%.2f per pixel)", static_cast<unsigned long long>(prepass), per_pixel(prepass));
+				ImGui::Text("MRT fragments: %llu (%.2f per pixel)", static_cast<unsigned long long>(geometry), per_pixel(geometry));
+				ImGui::Text("MRT colour writes: %.2f MB", geometry * mrt_bytes * to_mb);
+				//prepass fragments ~= what DIRECT would have shaded
+				if (geometry > 0)
+					ImGui::Text("Overdraw removed: %.2fx", static_cast<double>(prepass) / geometry);
+				break;
+			}
+			case EGBufferMode::VISIBILITY_BUFFER:
+			{
+				const uint64_t resolved = mResolveSamples.GetLastResult();
+				ImGui::Text("Visibility fragments: %llu (%.2f per pixel)", static_cast<unsigned long long>(geometry), per_pixel(geometry));
+				ImGui::Text("Visibility writes: %.2f MB", geometry * vis_bytes * to_mb);
+				ImGui::Text("Resolved pixels: %llu, MRT colour writes: %.2f MB", static_cast<unsigned long long>(resolved), resolved * mrt_bytes * to_mb);
+				if (resolved > 0)
+					ImGui::Text("Overdraw: %.2fx", static_cast<double>(geometry) / resolved);
+				break;
+			}
+			default:
+				break;
+			}
+
+			ImGui::SeparatorText("GPU passes");
+			auto pass_names = GPUPassToStringArray();
+			const EGPUPass gbuffer_passes[] = { EGPUPass::VISIBILITY, EGPUPass::GBUFFER_VS, EGPUPass::GBUFFER_WS };
+			for (EGPUPass pass : gbuffer_passes)
+				ImGui::Text("%-12s %.3f ms", pass_names[static_cast<size_t>(pass)], mGPUTimers[static_cast<size_t>(pass)].GetLastMs());
+		}
+		ImGui::End();
+	}
+}
+
+void SSAOProgram::RunKernelPatternComparison(const char* csv_path)
+{
+	const uint32_t width = mDisplayManager->GetWidth();
+	const uint32_t height = mDisplayManager->GetHeight();
+	const size_t pixels = static_cast<size_t>(width) * height;
+	const int tap_counts[] = { 64, 32, 16 };
+	constexpr int reference_taps = MAX_SSAO_KERNEL_SIZE;
+	//reference kernels are independent of every candidate (pattern & seed), averaging cancels their own noise
+	constexpr int reference_kernels = 8;
+	constexpr int reference_seed_offset = 7919;
+	constexpr uint32_t settle_frames = 2;
+
+	const float aspect_ratio = mDisplayManager->GetAspectRatio();
+	const glm::vec3 view_pos = glm::vec3(0.0f, 6.0f, 14.0f);
+	const FrameView frame_view = { view_pos, mCamera->mFar, mCamera->ProjMat(aspect_ratio),
+								   glm::lookAt(view_pos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) };
+	const SSAO prev_ssao = mSSAOParameters;
+	const bool prev_adaptive = bAdaptiveSSAO;
+	bAdaptiveSSAO = false;
+	mSSAOParameters.resolutionScale = 1.0f;
+
+	std::vector<float> reference(pixels), reference_blurred(pixels), ao(pixels), ao_blurred(pixels);
+	const int kernel_seed = prev_ssao.kernelSeed;
+	const int noise_seed = prev_ssao.noiseSeed;
+	//renders till the kernel/noise regeneration went through, reads the raw SSAO target
+	auto render_ao = [&](std::vector<float>& out) {
+		mSSAOParameters.bIsDirtySampleKernel = true;
+		mSSAOParameters.bIsDirtyNoiseParameter = true;
+		for (uint32_t i = 0; i < settle_frames; i++)
+		{
+			mFrameArena.Reset();
+			RenderFrame(frame_view);
+		}
+		glFinish();
+		mSSAOFBO.Bind();
+		GLint prev_alignment = 4;
+		glGetIntegerv(GL_PACK_ALIGNMENT, &prev_alignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, out.data());
+		glPixelStorei(GL_PACK_ALIGNMENT, prev_alignment);
+		mSSAOFBO.UnBind();
+		return mGPUTimers[static_cast<size_t>(EGPUPass::SSAO)].ResolveLatestMs();
+	};
+	//same 4x4 box as the lighting pass (blur radius 2)
+	auto blur = [&](const std::vector<float>& src, std::vector<float>& dst) {
+		mJobPool.ParallelFor(height, [&](uint32_t y) {
+			for (uint32_t x = 0; x < width; x++)
+			{
+				float sum = 0.0f;
+				for (int dy = -2; dy < 2; dy++)
+				{
+					for (int dx = -2; dx < 2; dx++)
+					{
+						uint32_t sx = static_cast<uint32_t>(std::clamp(static_cast<int>(x) + dx, 0, static_cast<int>(width) - 1));
+						uint32_t sy = static_cast<uint32_t>(std::clamp(static_cast<int>(y) + dy, 0, static_cast<int>(height) - 1));
+						sum += src[static_cast<size_t>(sy) * width + sx];
+					}
+				}
+				dst[static_cast<size_t>(y) * width + x] = sum / 16.0f;
+			}
+		});
+	};
+	auto rmse = [pixels](const std::vector<float>& a, const std::vector<float>& b) {
+		double sum = 0.0;
+		for (size_t i = 0; i < pixels; i++)
+			sum += static_cast<double>(a[i] - b[i]) * (a[i] - b[i]);
+		return std::sqrt(sum / static_cast<double>(pixels));
+	};
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : nullptr;
+	if (csv)
+		fprintf(csv, "pattern,cosine,noise,taps,kernel_seed,noise_seed,rmse,blurred_rmse,ssao_gpu_ms\n");
+	printf("[Kernel A/B] %ux%u, kernel seed %d, noise seed %d, reference %d x %d tap random kernels (seeds %d+)\n", width, height,
+		   kernel_seed, noise_seed, reference_kernels, reference_taps, kernel_seed + reference_seed_offset);
+	printf("[Kernel A/B] %-11s %-8s %-6s %5s %10s %12s %10s\n", "pattern", "weight", "noise", "taps", "rmse", "blurred rmse", "gpu(ms)");
+
+	for (bool cosine : { false, true })
+	{
+		//mean of dense random kernels of the same weighting, unbiased towards any candidate pattern
+		mSSAOParameters.bCosineWeighted = cosine;
+		mSSAOParameters.kernelPattern = SSAO::KernelPattern::RANDOM;
+		mSSAOParameters.noiseType = SSAO::NoiseType::WHITE;
+		mSSAOParameters.kernelSize = reference_taps;
+		mSSAOParameters.sampleCount = 0;
+		std::fill(reference.begin(), reference.end(), 0.0f);
+		for (int k = 0; k < reference_kernels; k++)
+		{
+			mSSAOParameters.kernelSeed = kernel_seed + reference_seed_offset + k;
+			mSSAOParameters.noiseSeed = noise_seed + reference_seed_offset + k;
+			render_ao(ao);
+			for (size_t i = 0; i < pixels; i++)
+				reference[i] += ao[i] / static_cast<float>(reference_kernels);
+		}
+		blur(reference, reference_blurred);
+		mSSAOParameters.kernelSeed = kernel_seed;
+		mSSAOParameters.noiseSeed = noise_seed;
+
+		for (int pattern = 0; pattern < static_cast<int>(SSAO::KernelPatternToStringArray.size()); pattern++)
+		{
+			for (int noise = 0; noise < static_cast<int>(SSAO::NoiseTypeToStringArray.size()); noise++)
+			{
+				mSSAOParameters.kernelPattern = static_cast<SSAO::KernelPattern>(pattern);
+				mSSAOParameters.noiseType = static_cast<SSAO::NoiseType>(noise);
+				mSSAOParameters.kernelSize = tap_counts[0];
+				for (int taps : tap_counts)
+				{
+					//reduced counts stride through the 64 tap kernel like the governor & adaptive tiles do
+					mSSAOParameters.sampleCount = taps;
+					double gpu_ms = render_ao(ao);
+					blur(ao, ao_blurred);
+					double error = rmse(ao, reference);
+					double blurred_error = rmse(ao_blurred, reference_blurred);
+					printf("[Kernel A/B] %-11s %-8s %-6s %5d %10.5f %12.5f %10.3f\n", SSAO::KernelPatternToStringArray[pattern],
+						   cosine ? "cosine" : "uniform", SSAO::NoiseTypeToStringArray[noise], taps, error, blurred_error, gpu_ms);
+					if (csv)
+						fprintf(csv, "%s,%d,%s,%d,%d,%d,%.6f,%.6f,%.4f\n", SSAO::KernelPatternToStringArray[pattern], cosine ? 1 : 0,
+								SSAO::NoiseTypeToStringArray[noise], taps, mSSAOParameters.kernelSeed, mSSAOParameters.noiseSeed,
+								error, blurred_error, gpu_ms);
+				}
+			}
+		}
+	}
+	if (csv)
+		fclose(csv);
+
+	bAdaptiveSSAO = prev_adaptive;
+	mSSAOParameters = prev_ssao;
+	mSSAOParameters.bIsDirtySampleKernel = true;
+	mSSAOParameters.bIsDirtyNoiseParameter = true;
+}
+
+void SSAOProgram::UpdateQualityGovernor()
+{
+	if (!bQualityGovernor)
+		return;
+	//passes that run every frame, the cached shadow pass only redraws now & then so its timer goes stale
+	const EGPUPass frame_passes[] = { EGPUPass::VISIBILITY, EGPUPass::GBUFFER_VS, EGPUPass::GBUFFER_WS, EGPUPass::SSAO, EGPUPass::LIGHTING };
+	double gpu_ms = 0.0;
+	for (EGPUPass pass : frame_passes)
+	{
+		if (pass == EGPUPass::VISIBILITY && mGBufferMode != EGBufferMode::VISIBILITY_BUFFER)
+			continue;
+		gpu_ms += mGPUTimers[static_cast<size_t>(pass)].GetLastMs();
+	}
+	if (mQualityGovernor.Update(static_cast<float>(gpu_ms) + mGovernorSyntheticLoadMs))
+		ApplyQualityLevel(mQualityGovernor.GetLevelSettings());
+}
+
+void SSAOProgram::ApplyQualityLevel(const SSAOQualityLevel& level)
+{
+	//no dirty flags => kernel & noise stay as they are
+	mSSAOParameters.sampleCount = level.sampleCount;
+	mSSAOParameters.resolutionScale = level.resolutionScale;
+	mSSAOParameters.blurRadius = level.blurRadius;
+}
+
+bool SSAOProgram::RunQualityGovernorTest(const char* csv_path)
+{
+	constexpr uint32_t calibration_frames = 60;
+	struct LoadPhase { const char* label; float loadFraction; uint32_t frames; };
+
+	const float aspect_ratio = mDisplayManager->GetAspectRatio();
+	const glm::vec3 view_pos = glm::vec3(0.0f, 6.0f, 14.0f);
+	const FrameView frame_view = { view_pos, mCamera->mFar, mCamera->ProjMat(aspect_ratio),
+								   glm::lookAt(view_pos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) };
+
+	const SSAO prev_ssao = mSSAOParameters;
+	const bool prev_governor = bQualityGovernor;
+
+	//GPU frame time (governed passes) at the top & bottom rungs, blocking reads after glFinish
+	auto measure_level = [&](uint32_t level) {
+		ApplyQualityLevel(SSAOQualityGovernor::GetLevelSettings(level));
+		Benchmark::TimingStats stats;
+		stats.Reserve(calibration_frames);
+		for (uint32_t i = 0; i < calibration_frames; i++)
+		{
+			mFrameArena.Reset();
+			RenderFrame(frame_view);
+			glFinish();
+			double gpu_ms = 0.0;
+			for (EGPUPass pass : { EGPUPass::GBUFFER_VS, EGPUPass::GBUFFER_WS, EGPUPass::SSAO, EGPUPass::LIGHTING })
+				gpu_ms += mGPUTimers[static_cast<size_t>(pass)].ResolveLatestMs();
+			if (mGBufferMode == EGBufferMode::VISIBILITY_BUFFER)
+				gpu_ms += mGPUTimers[static_cast<size_t>(EGPUPass::VISIBILITY)].ResolveLatestMs();
+			stats.Add(gpu_ms);
+		}
+		return static_cast<float>(stats.Percentile(50.0));
+	};
+	bQualityGovernor = false;
+	const float top_ms = measure_level(QUALITY_LEVEL_COUNT - 1);
+	const float bottom_ms = measure_level(0);
+	const float headroom = std::max(top_ms - bottom_ms, 0.0f);
+
+	//target => top quality sits inside the band with no load
+	//load step => top quality breaks the band, the bottom rung still fits
+	mQualityGovernor.Reset(QUALITY_LEVEL_COUNT - 1);
+	mQualityGovernor.mTargetMs = top_ms * 1.25f;
+	const float upper_ms = mQualityGovernor.mTargetMs * (1.0f + mQualityGovernor.mUpperBand);
+	const float load_ms = (upper_ms - top_ms) + 0.5f * headroom;
+	ApplyQualityLevel(mQualityGovernor.GetLevelSettings());
+	bQualityGovernor = true;
+
+	printf("[Governor Test] GPU frame %.3fms at level %u, %.3fms at level 0 => target %.3fms, load step %.3fms\n",
+		   top_ms, QUALITY_LEVEL_COUNT - 1, bottom_ms, mQualityGovernor.mTargetMs, load_ms);
+	if (headroom < 0.05f * top_ms)
+		printf("[Governor Test] SSAO is under 5%% of the frame, the ladder has little to trade\n");
+
+	const LoadPhase phases[] =
+	{
+		{ "baseline", 0.0f, 240 },
+		{ "load step", 1.0f, 480 },
+		{ "load removed", 0.0f, 720 },
+	};
+
+	FILE* csv = csv_path ? fopen(csv_path, "w") : nullptr;
+	if (csv)
+		fprintf(csv, "frame,phase,load_ms,measured_ms,smoothed_ms,level,cpu_ms\n");
+
+	bool passed = true;
+	uint32_t frame = 0;
+	std::array<uint32_t, 3> phase_end_levels{};
+	Benchmark::TimingStats cpu_stats;
+	Benchmark::TimingStats change_cpu_stats;
+	for (size_t p = 0; p < 3; p++)
+	{
+		const LoadPhase& phase = phases[p];
+		mGovernorSyntheticLoadMs = phase.loadFraction * load_ms;
+		uint32_t last_change = 0;
+		uint32_t change_count = 0;
+		bool level_changed = false;
+		for (uint32_t i = 0; i < phase.frames; i++, frame++)
+		{
+			const uint32_t level = mQualityGovernor.GetLevel();
+			double cpu_ms = 0.0;
+			{
+				Benchmark::ScopedTimer frame_timer(cpu_ms);
+				mFrameArena.Reset();
+				RenderFrame(frame_view);
+				UpdateQualityGovernor();
+				glFinish();
+			}
+			//first frame rendered with a new level shows any hitch
+			if (level_changed)
+				change_cpu_stats.Add(cpu_ms);
+			else
+				cpu_stats.Add(cpu_ms);
+			level_changed = (mQualityGovernor.GetLevel() != level);
+			if (level_changed)
+			{
+				last_change = i;
+				change_count++;
+			}
+			if (csv)
+				fprintf(csv, "%u,%s,%.4f,%.4f,%.4f,%u,%.4f\n", frame, phase.label, mGovernorSyntheticLoadMs,
+						mQualityGovernor.GetLastMeasuredMs(), mQualityGovernor.GetSmoothedMs(), mQualityGovernor.GetLevel(), cpu_ms);
+		}
+
+		//settled => nothing changed over the last third of the phase
+		const bool settled = (change_count == 0) || (last_change < phase.frames - phase.frames / 3);
+		const bool in_band = mQualityGovernor.GetSmoothedMs() <= upper_ms || mQualityGovernor.GetLevel() == 0;
+		phase_end_levels[p] = mQualityGovernor.GetLevel();
+		printf("[Governor Test] %-13s %u changes, last at +%u frames, level %u, %.3fms smoothed%s%s\n", phase.label, change_count,
+			   last_change, phase_end_levels[p], mQualityGovernor.GetSmoothedMs(), settled ? "" : "  NOT SETTLED", in_band ? "" : "  OVER BUDGET");
+		passed &= settled && in_band;
+	}
+	if (csv)
+		fclose(csv);
+
+	//quality has to drop under load & come back once it is gone
+	const bool stepped_down = phase_end_levels[1] < phase_end_levels[0];
+	const bool recovered = phase_end_levels[2] > phase_end_levels[1];
+	passed &= stepped_down && recovered;
+
+	mQualityGovernor.PrintLog();
+	printf("[Governor Test] CPU frame %.3fms median, %.3fms max on level changes (%zu) vs %.3fms p99 otherwise\n",
+		   cpu_stats.Percentile(50.0), change_cpu_stats.Max(), change_cpu_stats.Count(), cpu_stats.Percentile(99.0));
+	printf("[Governor Test] %s\n", passed ? "PASSED" : "FAILED");
+
+	mGovernorSyntheticLoadMs = 0.0f;
+	bQualityGovernor = prev_governor;
+	mSSAOParameters = prev_ssao;
+	return passed;
+}
+
+void SSAOProgram::QualityGovernorEditor()
+{
+	HELPER_REGISTER_UIFLAG("SSAO Quality Governor", p_open_flag, false);
+	if (p_open_flag)
+	{
+		if (ImGui::Begin("SSAO Quality Governor", &p_open_flag))
+		{
+			if (ImGui::Checkbox("Enable governor", &bQualityGovernor))
+			{
+				if (bQualityGovernor)
+				{
+					mManualQuality = { mSSAOParameters.sampleCount, mSSAOParameters.resolutionScale, mSSAOParameters.blurRadius };
+					mQualityGovernor.Reset(QUALITY_LEVEL_COUNT - 1);
+					ApplyQualityLevel(mQualityGovernor.GetLevelSettings());
+				}
+				else
+				{
+					//hand tuning takes over where it left off
+					ApplyQualityLevel(mManualQuality);
+				}
+			}
+			ImGui::DragFloat("Target GPU frame (ms)", &mQualityGovernor.mTargetMs, 0.05f, 0.5f, 100.0f, "%.2f");
+			ImGui::SliderFloat("Upper band", &mQualityGovernor.mUpperBand, 0.0f, 0.5f, "%.2f");
+			ImGui::SliderFloat("Lower band", &mQualityGovernor.mLowerBand, 0.0f, 0.5f, "%.2f");
+			ImGui::SliderFloat("Smoothing", &mQualityGovernor.mSmoothing, 0.01f, 1.0f, "%.2f");
+			int frames[3] = { static_cast<int>(mQualityGovernor.mDowngradeFrames), static_cast<int>(mQualityGovernor.mUpgradeFrames),
+							  static_cast<int>(mQualityGovernor.mSettleFrames) };
+			if (ImGui::DragInt3("Down / up / settle frames", frames, 1.0f, 1, 600))
+			{
+				mQualityGovernor.mDowngradeFrames = static_cast<uint32_t>(frames[0]);
+				mQualityGovernor.mUpgradeFrames = static_cast<uint32_t>(frames[1]);
+				mQualityGovernor.mSettleFrames = static_cast<uint32_t>(frames[2]);
+			}
+			ImGui::SliderFloat("Synthetic load (ms)", &mGovernorSyntheticLoadMs, 0.0f, 20.0f, "%.2f");
+
+			ImGui::SeparatorText("State");
+			const SSAOQualityLevel& level = mQualityGovernor.GetLevelSettings();
+			ImGui::Text("Level %u / %u: %d samples, %.2fx resolution, blur %d", mQualityGovernor.GetLevel(), QUALITY_LEVEL_COUNT - 1,
+						(level.sampleCount > 0) ? level.sampleCount : mSSAOParameters.kernelSize, level.resolutionScale, level.blurRadius);
+			ImGui::Text("Measured %.3fms, smoothed %.3fms, upgrade back off x%u", mQualityGovernor.GetLastMeasuredMs(),
+						mQualityGovernor.GetSmoothedMs(), 1u << mQualityGovernor.GetBackoff());
+
+			ImGui::SeparatorText("Decisions (newest first)");
+			for (uint32_t i = mQualityGovernor.GetLogCount(); i > 0; i--)
+			{
+				const GovernorLogEntry& entry = mQualityGovernor.GetLogEntry(i - 1);
+				ImGui::Text("frame %llu: %u => %u at %.2fms%s", static_cast<unsigned long long>(entry.frame), entry.fromLevel, entry.toLevel,
+							entry.smoothedMs, entry.bRevertedUpgrade ? " (reverted upgrade)" : "");
+			}
 		}
 		ImGui::End();
 	}
@@ -9,6 +9,20 @@
 #include "pregl/Renderer/GPUVertexData.h"
 
 #include "pregl/Core/ShaderHotReloadTracker.h"
+#include "pregl/Core/UI_Window_Panel_Editors.h"
+
+#include "FrameMemory.h"
+#include "AOBatchRenderer.h"
+#include "SceneGenerator.h"
+#include "BenchmarkUtils.h"
+#include "UniformRingBuffer.h"
+#include "ClusteredLighting.h"
+#include "GPUTimer.h"
+#include "CascadedShadowMap.h"
+#include "VisibilityBuffer.h"
+#include "SSAOTileClassifier.h"
+#include "QualityGovernor.h"
+#include "SamplePatterns.h"
 
 //FORWARD DECLARE
 struct BaseMaterial;
@@ -34,6 +48,17 @@ struct GameObject
 
 	bool asMultipleMesh = false;
 	std::vector<RenderableMesh> meshes;
+	//dynamic objects are redrawn into the shadow map each frame, static ones are cached
+	bool isDynamic = false;
+};
+
+//Camera data a frame is rendered with (interactive camera or a batch pose)
+struct FrameView
+{
+	glm::vec3 position;
+	float far;
+	glm::mat4 proj;
+	glm::mat4 view;
 };
 
 
@@ -49,6 +74,41 @@ static std::array<const char*, static_cast<size_t>(EAOSampleType::COUNT)> AOSamp
 	return{ "VS_SAMPLE", "WS_SAMPLE"};
 }
 
+//passes with a GPU timer
+enum class EGPUPass : uint8_t
+{
+	SHADOW,
+	VISIBILITY,
+	GBUFFER_VS,
+	GBUFFER_WS,
+	SSAO,
+	LIGHTING,
+
+	COUNT,
+};
+static std::array<const char*, static_cast<size_t>(EGPUPass::COUNT)> GPUPassToStringArray()
+{
+	return{ "Shadow", "Visibility", "GBuffer VS", "GBuffer WS", "SSAO", "Lighting" };
+}
+
+//how the G-buffers get filled
+enum class EGBufferMode : uint8_t
+{
+	DIRECT,				//G-buffer shader for every fragment passing the depth test
+	DEPTH_PREPASS,		//depth only pass, then the G-buffer shader with GL_EQUAL (one MRT write per pixel)
+	VISIBILITY_BUFFER,	//instance & triangle ids only, attributes resolved in a fullscreen pass.
+						//Approximation: no vertex buffer access in the resolve => flat face normals from depth,
+						//AO & lighting differ from DIRECT/DEPTH_PREPASS on smooth shaded meshes
+
+	COUNT,
+};
+static std::array<const char*, static_cast<size_t>(EGBufferMode::COUNT)> GBufferModeToStringArray()
+{
+	return{ "DIRECT", "DEPTH_PREPASS", "VISIBILITY_BUFFER (flat normals)" };
+}
+
+constexpr int MAX_SSAO_KERNEL_SIZE = 256; //<-- matches uSamples[256] in SSAO.frag
+
 //SSAO STRUCTURE 
 struct SSAO
 {
@@ -66,6 +126,12 @@ struct SSAO
 	bool bShadingEnable = true;
 	bool bBlurEnable = true;
 
+	//per frame quality knobs (driven by the quality governor), changing them rebuilds nothing
+	int sampleCount = 0;			//evenly spaced subset of the kernel, 0 => kernelSize
+	float resolutionScale = 1.0f;	//SSAO renders into this lower left sub rect of its target
+	int blurRadius = 2;				//2r x 2r box, r 2 => 4x4 matching the default noise size
+	int GetEffectiveSampleCount() const { return (sampleCount > 0 && sampleCount < kernelSize) ? sampleCount : kernelSize; }
+
 	enum class DistributionType : int
 	{
 		LINEAR,			//Straight line distribution
@@ -85,18 +151,53 @@ struct SSAO
 		"QUINTIC",
 	};
 
+	//where the kernel points come from, low discrepancy sets hold up at a fraction of the taps
+	enum class KernelPattern : int
+	{
+		RANDOM,			//white noise
+		STRATIFIED,		//jittered strata per axis (latin hypercube)
+		HALTON,			//bases 2, 3, 5, bit reversed slots so strided subsets stay low discrepancy
+		FIBONACCI,		//golden angle spiral
+	};
+	KernelPattern kernelPattern = KernelPattern::RANDOM;
+	bool bCosineWeighted = false;
+	int kernelSeed = 1;
+
+	static constexpr std::array<const char*, 4>KernelPatternToStringArray =
+	{
+		"RANDOM",
+		"STRATIFIED",
+		"HALTON",
+		"FIBONACCI",
+	};
+
+	//per pixel kernel rotation
+	enum class NoiseType : int
+	{
+		WHITE,			//noiseSize^2 random rotations
+		BLUE,			//void & cluster ranks => rotation angle, cached to disk
+	};
+	NoiseType noiseType = NoiseType::WHITE;
+	int blueNoiseSize = 64;
+	int noiseSeed = 1;
+
+	static constexpr std::array<const char*, 2>NoiseTypeToStringArray =
+	{
+		"WHITE",
+		"BLUE",
+	};
+	int GetNoiseTextureSize() const { return (noiseType == NoiseType::BLUE) ? blueNoiseSize : noiseSize; }
+
 	float minDist = 0.1f;
 	float maxDist = 1.0f;
 
 	bool bIsDirtySampleKernel = true;// false;
 	bool bIsDirtyNoiseParameter = true;//false;
-	bool bIsDirtySampleParameter = true;//false;
 	//for comparison
 	bool operator==(const SSAO& rhs)
 	{
 		bool similar_data = CompareSSAOParameterDirty(rhs);
 		similar_data &= CompareSSAOSampleKernelDirty(rhs);
-		similar_data &= CompareSSAOSampleParameterDirty(rhs);
 		return similar_data;
 	}
 
@@ -107,6 +208,9 @@ struct SSAO
 		changed |= (minDist != rhs.minDist);
 		changed |= (maxDist != rhs.maxDist);
 		changed |= (kernelSize != rhs.kernelSize);
+		changed |= (kernelPattern != rhs.kernelPattern);
+		changed |= (bCosineWeighted != rhs.bCosineWeighted);
+		changed |= (kernelSeed != rhs.kernelSeed);
 		bIsDirtySampleKernel = changed;
 		return bIsDirtySampleKernel;
 	}
@@ -115,28 +219,23 @@ struct SSAO
 	{
 		bool changed = false;
 		changed |= (noiseSize != rhs.noiseSize);
+		changed |= (noiseType != rhs.noiseType);
+		changed |= (blueNoiseSize != rhs.blueNoiseSize);
+		changed |= (noiseSeed != rhs.noiseSeed);
 		bIsDirtyNoiseParameter = changed;
 		return bIsDirtyNoiseParameter;
 	}
 
-	bool CompareSSAOSampleParameterDirty(const SSAO& rhs)
-	{
-		bool changed = false;
-		changed |= (kernelSize != rhs.kernelSize);
-		changed |= (sampleRadius != rhs.sampleRadius);
-		changed |= (power != rhs.power);
-		changed |= (bias != rhs.bias);
-		bIsDirtySampleParameter = changed;
-		return bIsDirtySampleParameter;
-	}
 	bool operator!=(const SSAO& rhs) { return !(*this == rhs); }
 	void ResizeNoiseScale(unsigned int width, unsigned int height);
 	void GenerateSamplePoint(std::vector<glm::vec3>& sample_kernel);
-	void GenerateNoiseTexture(std::shared_ptr<GPUResource::Texture>& noise_texture);
+	//noise data is transient, only lives in the frame arena till the texture upload
+	//blue noise generation runs on the pool (first use of a size & seed only, then the disk cache)
+	void GenerateNoiseTexture(std::shared_ptr<GPUResource::Texture>& noise_texture, FrameMemory::FrameArena& arena, ThreadPool& pool);
 };
 
 constexpr int MAX_MESH_BUFFER_SIZE = 5;
-constexpr int MAX_MATERIAL_BUFFER_SIZE = 10;
+constexpr int MAX_MATERIAL_BUFFER_SIZE = 32;
 class SSAOProgram : public GraphicsProgramInterface
 {
 public:
@@ -149,6 +248,38 @@ public:
 	virtual void OnDestroy() override;
 	virtual void OnUI() override;
 
+	//Renders frames (update + UI) with heap instrumentation, fails if any frame after warmup allocates
+	//requires AO_TRACK_HEAP_ALLOCATIONS build
+	bool RunSteadyStateAllocationCheck(uint32_t warmup_frames, uint32_t test_frames);
+
+	//Renders G-buffer, SSAO & lighting per pose and writes the SSAO target to output_dir/ao_#####.pgm
+	//ring depth 1 => synchronous readback, empty output dir => readback only
+	AOBatchStats RunAOBatch(const std::vector<AOBatchPose>& poses, const std::string& output_dir, uint32_t ring_depth = 3);
+	//views/s for synchronous readback, PBO ring & PBO ring + writers over an orbit of view_count poses
+	void RunAOBatchBenchmark(uint32_t view_count);
+
+	//replaces the scene objects, authored materials are kept & generated ones appended
+	void LoadProceduralScene(const ProceduralSceneDesc& desc);
+	void LoadDefaultScene();
+	const ProceduralSceneDesc& GetProceduralSceneDesc() const { return mProceduralSceneDesc; }
+	//CPU submit, frame time & memory at 1k, 10k & 100k generated objects, optional csv output
+	void RunSceneScalingBenchmark(const char* csv_path = nullptr);
+
+	//regenerates mLocalLights from count & seed
+	void LoadLocalLights(uint32_t count, uint32_t seed);
+	//CPU cluster build, GPU lighting pass & frame time at 16, 256 & 4096 local lights, optional csv output
+	void RunLightingBenchmark(const char* csv_path = nullptr);
+
+	void SetGBufferMode(EGBufferMode mode) { mGBufferMode = mode; }
+
+	//raw & 4x4 blurred AO error of every kernel pattern x noise type at 64, 32 & 16 taps against the mean
+	//of independently seeded 256 tap random kernels with the same weighting, fixed seeds & view, optional csv output
+	void RunKernelPatternComparison(const char* csv_path = nullptr);
+
+	//governor under a synthetic load step (baseline, load, load removed), prints the decision log
+	//passes when each phase settles & quality drops under load then recovers, optional per frame csv
+	bool RunQualityGovernorTest(const char* csv_path = nullptr);
+
 	~SSAOProgram() {
 		printf("Ambient Occulsion Gfx Program Closed!!!!!!\n");
 	}
@@ -159,9 +290,24 @@ private:
 	Lighting::Directional mDirLight;
 	bool bOnlyRenderAONoLighting = false;
 
+	//clustered local lights
+	std::vector<LocalLight> mLocalLights;
+	ClusteredLightCuller mLightCuller;
+	//opt in from the Local Lights window or --light-bench
+	bool bClusteredLighting = false;
+	int mLocalLightCount = 0;
+	uint32_t mLocalLightSeed = 7;
+	ThreadPool mJobPool;
+
+	//directional light shadows
+	CascadedShadowMap mShadowMap;
+	Shader mShadowDepthShader;
+	bool bShadowsEnabled = true;
+	size_t mDynamicObjectCount = 0;
+
 
 	//buffers
-	GPUResource::UniformBuffer mCameraUBO;
+	UniformRingBuffer mUniformRing;
 	GPUResource::MultiRenderTarget mGBuffer_VS; //VS => ViewSpace
 	GPUResource::Framebuffer mSSAOFBO;
 	
@@ -175,6 +321,20 @@ private:
 	//Just for convienvce just have an addtional MRT and easily debugging 
 	GPUResource::MultiRenderTarget mGBuffer_WS;
 
+	//overdraw reduction
+	EGBufferMode mGBufferMode = EGBufferMode::DIRECT;
+	Shader mDepthPrepassShader;
+	Shader mVisibilityShader;
+	Shader mVisibilityResolveShader;
+	VisibilityBuffer mVisBuffer;
+	std::array<GPUVisMaterial, MAX_MATERIAL_BUFFER_SIZE> mVisMaterials;
+	std::vector<uint32_t> mVisInstanceMaterials;
+	bool bVisInstancesDirty = true;
+	//fragments passing the depth test, measured on the view space G-buffer
+	GPUSampleCounter mPrepassSamples;
+	GPUSampleCounter mGeometrySamples;
+	GPUSampleCounter mResolveSamples;
+
 	std::vector<GameObject> mGameObjects;
 
 	
@@ -183,6 +343,8 @@ private:
 	//////////////////////////
 	std::array<RenderableMesh, MAX_MESH_BUFFER_SIZE> mMeshBuffer;
 	std::vector<std::shared_ptr<BaseMaterial>> mMaterialBuffer;
+	size_t mAuthoredMaterialCount = 0;
+	ProceduralSceneDesc mProceduralSceneDesc;
 
 	//SSAO data
 	SSAO mSSAOParameters;
@@ -190,13 +352,59 @@ private:
 	std::shared_ptr<GPUResource::Texture> mNoiseTex = nullptr;
 	std::vector<glm::vec3> mSamplingKernelPoints;
 
+	//adaptive sample count (see SSAOTileClassifier)
+	SSAOTileClassifier mSSAOTiles;
+	Shader mSSAOTileClassifyShader;
+	Shader mSSAOTileShader; //SSAO.frag driven by tile quads
+	bool bAdaptiveSSAO = false;
+	bool bSSAOHeatmap = false;
+	bool bSSAOTileStats = false;
+	float mSSAOTileDepthThreshold = 0.05f;
+	float mSSAOTileNormalThreshold = 0.1f;
+
+	//frame time budget
+	SSAOQualityGovernor mQualityGovernor;
+	bool bQualityGovernor = false;
+	//hand tuned quality, put back when the governor is switched off
+	SSAOQualityLevel mManualQuality = { 0, 1.0f, 2 };
+	//added to the measured GPU time, stands in for other work sharing the budget
+	float mGovernorSyntheticLoadMs = 0.0f;
+
 	Util::ShaderHotReloadTracker mShaderHotReloaderTracker;
 
+	//////////////////////////
+	//frame memory
+	//////////////////////////
+	FrameMemory::FrameArena mFrameArena;
+	//"uSamples[i]" names built once, avoids per upload string allocs
+	std::array<std::array<char, 16>, MAX_SSAO_KERNEL_SIZE> mSampleUniformNames;
+	UI::Windows::MaterialList mMaterialList;
+
+	std::array<GPUTimer, static_cast<size_t>(EGPUPass::COUNT)> mGPUTimers;
+
 	void InitSceneData();
-	void UpdateUBOs(EditorCamera& cam, float aspect_ratio);
+	void CreateDefaultScene();
+	void RefreshMaterialList();
+	void RenderFrame(const FrameView& view);
+	void UpdateUBOs(const FrameView& view);
 	void DrawScene(Shader& shader, bool apply_material = false);
+	void RenderShadowPass(const FrameView& view);
+	void RenderVisibilityPass();
+	void RenderGBuffer(GPUResource::MultiRenderTarget& gbuffer, Shader& geometry_shader, EGPUPass pass, bool world_space);
+	void DrawShadowCasters(Shader& shader, bool dynamic);
+	void RefreshDynamicObjectCount();
+	//feeds the summed GPU pass times to the governor, applies the level on a change
+	void UpdateQualityGovernor();
+	void ApplyQualityLevel(const SSAOQualityLevel& level);
 	void MaterialShaderHelper(Shader& shader, const BaseMaterial& mat);
 
 
+	//OnUI body, tracked as the "UI" pass of the frame
+	void EditorsUI();
 	void GameObjectsInspectorEditor(std::vector<GameObject>& game_objects);
+	void FrameAllocationsEditor();
+	void SceneGeneratorEditor();
+	void LocalLightsEditor();
+	void OverdrawEditor();
+	void QualityGovernorEditor();
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "SSAOTileClassifier.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	//matches GL's DrawArraysIndirectCommand
+	struct DrawArraysIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint first;
+		GLuint baseInstance;
+	};
+	constexpr GLsizeiptr COMMANDS_SIZE = sizeof(DrawArraysIndirectCommand) * SSAO_BUDGET_CLASS_COUNT;
+}
+
+void SSAOTileClassifier::Generate(uint32_t width, uint32_t height)
+{
+	Release();
+	mWidth = width;
+	mHeight = height;
+	glGenVertexArrays(1, &mEmptyVAO);
+	CreateTargets();
+}
+
+void SSAOTileClassifier::Release()
+{
+	ReleaseTargets();
+	if (mEmptyVAO)
+		glDeleteVertexArrays(1, &mEmptyVAO);
+	mEmptyVAO = 0;
+}
+
+void SSAOTileClassifier::Resize(unsigned int width, unsigned int height)
+{
+	if (width == 0 || height == 0 || (width == mWidth && height == mHeight))
+		return;
+	mWidth = width;
+	mHeight = height;
+	ReleaseTargets();
+	CreateTargets();
+}
+
+void SSAOTileClassifier::CreateTargets()
+{
+	mTileCountX = (mWidth + SSAO_TILE_SIZE - 1) / SSAO_TILE_SIZE;
+	mTileCountY = (mHeight + SSAO_TILE_SIZE - 1) / SSAO_TILE_SIZE;
+
+	glGenTextures(1, &mTileClassTexture);
+	glBindTexture(GL_TEXTURE_2D, mTileClassTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, mTileCountX, mTileCountY);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTileClassTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		printf("[SSAO Tiles] Tile class framebuffer incomplete\n");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	//worst case every tile in one class
+	const GLsizeiptr list_size = sizeof(GLuint) * static_cast<GLsizeiptr>(GetMaxTiles()) * SSAO_BUDGET_CLASS_COUNT;
+	glGenBuffers(1, &mTileBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, COMMANDS_SIZE + list_size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SSAOTileClassifier::ReleaseTargets()
+{
+	if (mFBO)
+		glDeleteFramebuffers(1, &mFBO);
+	if (mTileClassTexture)
+		glDeleteTextures(1, &mTileClassTexture);
+	if (mTileBuffer)
+		glDeleteBuffers(1, &mTileBuffer);
+	mFBO = mTileClassTexture = mTileBuffer = 0;
+}
+
+void SSAOTileClassifier::BeginClassify()
+{
+	//6 vertices (tile quad) per instance, instance counts filled by the classify pass
+	DrawArraysIndirectCommand commands[SSAO_BUDGET_CLASS_COUNT];
+	for (auto& command : commands)
+		command = { 6, 0, 0, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, COMMANDS_SIZE, commands);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	BindTileList();
+
+	glGetIntegerv(GL_VIEWPORT, mSavedViewport);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glViewport(0, 0, mTileCountX, mTileCountY);
+}
+
+void SSAOTileClassifier::EndClassify()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(mSavedViewport[0], mSavedViewport[1], mSavedViewport[2], mSavedViewport[3]);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void SSAOTileClassifier::DrawClass(uint32_t budget_class) const
+{
+	glBindVertexArray(mEmptyVAO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mTileBuffer);
+	glDrawArraysIndirect(GL_TRIANGLES, reinterpret_cast<const void*>(static_cast<uintptr_t>(sizeof(DrawArraysIndirectCommand) * budget_class)));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+void SSAOTileClassifier::BindTileList() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSAO_TILE_LIST_SSBO_BINDING, mTileBuffer);
+}
+
+void SSAOTileClassifier::BindTileClassTexture(uint32_t unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, mTileClassTexture);
+}
+
+void SSAOTileClassifier::ReadClassCounts(std::array<uint32_t, SSAO_BUDGET_CLASS_COUNT>& counts) const
+{
+	DrawArraysIndirectCommand commands[SSAO_BUDGET_CLASS_COUNT];
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mTileBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, COMMANDS_SIZE, commands);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	for (uint32_t c = 0; c < SSAO_BUDGET_CLASS_COUNT; c++)
+		counts[c] = commands[c].instanceCount;
+}
+
+std::array<int, SSAO_BUDGET_CLASS_COUNT> SSAOTileClassifier::ComputeBudgets(int kernel_size)
+{
+	//1/8, 1/4, 1/2 & full kernel, never below 4 taps
+	std::array<int, SSAO_BUDGET_CLASS_COUNT> budgets;
+	for (uint32_t c = 0; c < SSAO_BUDGET_CLASS_COUNT; c++)
+	{
+		int shift = static_cast<int>(SSAO_BUDGET_CLASS_COUNT - 1 - c);
+		budgets[c] = std::min(kernel_size, std::max(4, kernel_size >> shift));
+	}
+	return budgets;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+
+#include <array>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// SSAO TILE CLASSIFIER (ADAPTIVE SAMPLE COUNT)
+//////////////////////////////////////////////////
+//A classification pass (one fragment per SSAO_TILE_SIZE^2 tile) measures view space depth & normal variance,
+//writes the tile's budget class to an R8UI map & appends the tile to that class's list with an atomic.
+//The SSAO pass is then issued once per class via glDrawArraysIndirect, one instanced quad per tile,
+//so every tile in a draw runs the same sample count (no divergence within a draw).
+//Buffer layout => SSAO_BUDGET_CLASS_COUNT DrawArraysIndirectCommands, then one tile list per class.
+constexpr uint32_t SSAO_TILE_SIZE = 8;
+constexpr uint32_t SSAO_BUDGET_CLASS_COUNT = 4;
+constexpr uint32_t SSAO_TILE_LIST_SSBO_BINDING = 5;
+
+class SSAOTileClassifier
+{
+public:
+	SSAOTileClassifier() = default;
+	~SSAOTileClassifier() { Release(); }
+
+	SSAOTileClassifier(const SSAOTileClassifier&) = delete;
+	SSAOTileClassifier& operator=(const SSAOTileClassifier&) = delete;
+
+	void Generate(uint32_t width, uint32_t height);
+	void Release();
+	void Resize(unsigned int width, unsigned int height);
+
+	//resets the class counters & binds the tile map with a tile sized viewport, draw a fullscreen quad after
+	void BeginClassify();
+	//restores the viewport & makes the lists visible to the indirect draws
+	void EndClassify();
+	//tile quads of one class, bound vertex shader pulls the tile from the list
+	void DrawClass(uint32_t budget_class) const;
+
+	void BindTileList() const;
+	void BindTileClassTexture(uint32_t unit) const;
+
+	uint32_t GetTileCountX() const { return mTileCountX; }
+	uint32_t GetTileCountY() const { return mTileCountY; }
+	uint32_t GetMaxTiles() const { return mTileCountX * mTileCountY; }
+
+	//blocking readback of the per class tile counts, debug UI only
+	void ReadClassCounts(std::array<uint32_t, SSAO_BUDGET_CLASS_COUNT>& counts) const;
+
+	//per class sample count for a kernel size, few taps => full kernel.
+	//Budgets need not divide the kernel, SSAO.frag spreads any budget over every slot so all classes
+	//cover the full radius & neighbouring tiles only differ in noise (no AO extent seams)
+	static std::array<int, SSAO_BUDGET_CLASS_COUNT> ComputeBudgets(int kernel_size);
+
+private:
+	void CreateTargets();
+	void ReleaseTargets();
+
+	GLuint mFBO = 0;
+	GLuint mTileClassTexture = 0;
+	GLuint mTileBuffer = 0;
+	GLuint mEmptyVAO = 0;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mTileCountX = 0;
+	uint32_t mTileCountY = 0;
+	GLint mSavedViewport[4] = {};
+};
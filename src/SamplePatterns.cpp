@@ -0,0 +1,301 @@
+#include "SamplePatterns.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+	//void & cluster filter width (Ulichney), in texels
+	constexpr float VOID_CLUSTER_SIGMA = 1.5f;
+	//initial binary pattern density
+	constexpr float VOID_CLUSTER_INITIAL_FILL = 0.1f;
+	constexpr uint32_t BLUE_NOISE_CACHE_VERSION = 1;
+	constexpr uint32_t MAX_ROW_CHUNKS = 16;
+
+	struct BlueNoiseCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t size;
+		uint32_t seed;
+	};
+
+	//gaussian energy of a toroidal binary pattern, E[q] = sum over set p of g(q - p)
+	class EnergyField
+	{
+	public:
+		EnergyField(uint32_t size, ThreadPool& pool) : mSize(size), mPool(pool)
+		{
+			mLUT.resize(size * size);
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					//wrapped distance
+					float dx = static_cast<float>(std::min(x, size - x));
+					float dy = static_cast<float>(std::min(y, size - y));
+					mLUT[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * VOID_CLUSTER_SIGMA * VOID_CLUSTER_SIGMA));
+				}
+			}
+			mEnergy.assign(size * size, 0.0f);
+			mBits.assign(size * size, 0);
+			mRowChunks = std::min(size, MAX_ROW_CHUNKS);
+			mChunkBest.resize(mRowChunks);
+		}
+
+		uint8_t Get(uint32_t idx) const { return mBits[idx]; }
+
+		//set => 1 & adds its energy, clear => 0 & removes it
+		void Set(uint32_t idx, uint8_t bit)
+		{
+			if (mBits[idx] == bit)
+				return;
+			mBits[idx] = bit;
+			const float sign = bit ? 1.0f : -1.0f;
+			const uint32_t px = idx % mSize;
+			const uint32_t py = idx / mSize;
+			auto splat_rows = [&](uint32_t chunk) {
+				uint32_t y_begin = chunk * mSize / mRowChunks;
+				uint32_t y_end = (chunk + 1) * mSize / mRowChunks;
+				for (uint32_t y = y_begin; y < y_end; y++)
+				{
+					const float* lut_row = &mLUT[((y + mSize - py) % mSize) * mSize];
+					float* energy_row = &mEnergy[y * mSize];
+					for (uint32_t x = 0; x < mSize; x++)
+						energy_row[x] += sign * lut_row[(x + mSize - px) % mSize];
+				}
+			};
+			mPool.ParallelFor(mRowChunks, splat_rows);
+		}
+
+		//tightest cluster => highest energy among bit == 1, largest void => lowest among bit == 0
+		uint32_t FindExtremum(uint8_t bit, bool highest)
+		{
+			auto search_rows = [&](uint32_t chunk) {
+				uint32_t begin = (chunk * mSize / mRowChunks) * mSize;
+				uint32_t end = ((chunk + 1) * mSize / mRowChunks) * mSize;
+				Candidate best;
+				for (uint32_t i = begin; i < end; i++)
+				{
+					if (mBits[i] != bit)
+						continue;
+					if (best.idx == UINT32_MAX || (highest ? mEnergy[i] > best.energy : mEnergy[i] < best.energy))
+						best = { mEnergy[i], i };
+				}
+				mChunkBest[chunk] = best;
+			};
+			mPool.ParallelFor(mRowChunks, search_rows);
+
+			//chunks are in index order & only strictly better wins => lowest index on ties
+			Candidate best;
+			for (const Candidate& candidate : mChunkBest)
+			{
+				if (candidate.idx == UINT32_MAX)
+					continue;
+				if (best.idx == UINT32_MAX || (highest ? candidate.energy > best.energy : candidate.energy < best.energy))
+					best = candidate;
+			}
+			return best.idx;
+		}
+
+	private:
+		struct Candidate
+		{
+			float energy = 0.0f;
+			uint32_t idx = UINT32_MAX;
+		};
+
+		uint32_t mSize;
+		ThreadPool& mPool;
+		uint32_t mRowChunks;
+		std::vector<float> mLUT;
+		std::vector<float> mEnergy;
+		std::vector<uint8_t> mBits;
+		std::vector<Candidate> mChunkBest;
+	};
+
+	std::string BlueNoiseCachePath(uint32_t size, uint32_t seed)
+	{
+		return std::string(BLUE_NOISE_CACHE_DIR) + "/blue_noise_" + std::to_string(size) + "_" + std::to_string(seed) + ".bin";
+	}
+
+	bool ReadBlueNoiseCache(const std::string& path, uint32_t size, uint32_t seed, std::vector<uint32_t>& ranks)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return false;
+		BlueNoiseCacheHeader header;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "BNVC", 4) == 0 &&
+					 header.version == BLUE_NOISE_CACHE_VERSION && header.size == size && header.seed == seed;
+		if (valid)
+		{
+			ranks.resize(size * size);
+			valid = fread(ranks.data(), sizeof(uint32_t), ranks.size(), file) == ranks.size();
+		}
+		fclose(file);
+		return valid;
+	}
+
+	void WriteBlueNoiseCache(const std::string& path, uint32_t size, uint32_t seed, const std::vector<uint32_t>& ranks)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(BLUE_NOISE_CACHE_DIR, error);
+		FILE* file = fopen(path.c_str(), "wb");
+		if (!file)
+		{
+			printf("[Blue Noise] Could not write cache %s\n", path.c_str());
+			return;
+		}
+		BlueNoiseCacheHeader header = { { 'B', 'N', 'V', 'C' }, BLUE_NOISE_CACHE_VERSION, size, seed };
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(ranks.data(), sizeof(uint32_t), ranks.size(), file);
+		fclose(file);
+	}
+}
+
+namespace SamplePatterns
+{
+	float UniformFloat(std::mt19937& rng)
+	{
+		//24 bits => every value exact in a float, [0, 1)
+		return static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float UniformFloat(std::mt19937& rng, float lo, float hi)
+	{
+		return lo + (hi - lo) * UniformFloat(rng);
+	}
+
+	uint32_t UniformIndex(std::mt19937& rng, uint32_t count)
+	{
+		//32 bit fixed point multiply, no modulo bias towards low indices
+		return static_cast<uint32_t>((static_cast<uint64_t>(rng() & 0xFFFFFFFFu) * count) >> 32);
+	}
+
+	uint32_t WeightedIndex(const std::vector<float>& cumulative_weights, std::mt19937& rng)
+	{
+		const float target = UniformFloat(rng) * cumulative_weights.back();
+		//first running sum above the target, zero weight entries never match
+		auto it = std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), target);
+		return static_cast<uint32_t>(std::min<size_t>(it - cumulative_weights.begin(), cumulative_weights.size() - 1));
+	}
+
+	void Shuffle(std::vector<uint32_t>& values, std::mt19937& rng)
+	{
+		//Fisher-Yates
+		for (size_t i = values.size(); i > 1; i--)
+			std::swap(values[i - 1], values[rng() % i]);
+	}
+
+	float RadicalInverse(uint32_t index, uint32_t base)
+	{
+		const double inv_base = 1.0 / static_cast<double>(base);
+		double inv_base_n = inv_base;
+		double result = 0.0;
+		while (index > 0)
+		{
+			result += static_cast<double>(index % base) * inv_base_n;
+			index /= base;
+			inv_base_n *= inv_base;
+		}
+		return static_cast<float>(std::min(result, 0.99999994));
+	}
+
+	void BitReversalOrder(uint32_t count, std::vector<uint32_t>& order)
+	{
+		order.clear();
+		order.reserve(count);
+		uint32_t bits = 0;
+		while ((1u << bits) < count)
+			bits++;
+		//reverse & drop values past count, keeps strided slots close to a prefix for non power of 2 counts
+		for (uint32_t i = 0; i < (1u << bits) && order.size() < count; i++)
+		{
+			uint32_t reversed = 0;
+			for (uint32_t b = 0; b < bits; b++)
+				reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+			if (reversed < count)
+				order.push_back(reversed);
+		}
+	}
+
+	glm::vec3 HemisphereDirection(float u1, float u2, bool cosine_weighted)
+	{
+		//cosine => project a uniform disk point up (Malley)
+		const float z = cosine_weighted ? std::sqrt(1.0f - u1) : u1;
+		const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+		const float phi = glm::radians(360.0f) * u2;
+		return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+	}
+
+	void GenerateVoidAndCluster(uint32_t size, uint32_t seed, ThreadPool& pool, std::vector<uint32_t>& ranks)
+	{
+		const uint32_t texels = size * size;
+		ranks.assign(texels, 0);
+		EnergyField field(size, pool);
+
+		//initial random pattern
+		std::mt19937 rng(seed);
+		std::vector<uint32_t> shuffled(texels);
+		for (uint32_t i = 0; i < texels; i++)
+			shuffled[i] = i;
+		Shuffle(shuffled, rng);
+		const uint32_t initial_ones = std::max(1u, static_cast<uint32_t>(texels * VOID_CLUSTER_INITIAL_FILL));
+		for (uint32_t i = 0; i < initial_ones; i++)
+			field.Set(shuffled[i], 1);
+
+		//move tightest cluster => largest void till stable (prototype pattern)
+		for (uint32_t iter = 0; iter < texels; iter++)
+		{
+			uint32_t cluster = field.FindExtremum(1, true);
+			field.Set(cluster, 0);
+			uint32_t void_idx = field.FindExtremum(0, false);
+			field.Set(void_idx, 1);
+			if (void_idx == cluster)
+				break;
+		}
+		std::vector<uint8_t> prototype(texels);
+		for (uint32_t i = 0; i < texels; i++)
+			prototype[i] = field.Get(i);
+
+		//phase 1 => remove tightest clusters, ranks count down from the initial ones
+		for (uint32_t rank = initial_ones; rank > 0; rank--)
+		{
+			uint32_t cluster = field.FindExtremum(1, true);
+			field.Set(cluster, 0);
+			ranks[cluster] = rank - 1;
+		}
+
+		//phase 2 => back to the prototype, fill largest voids.
+		//Past half this is Ulichney's phase 3 as well: with a linear filter the energy of the zeros is a
+		//constant minus the energy of the ones, so their tightest cluster is the ones' largest void.
+		for (uint32_t i = 0; i < texels; i++)
+			field.Set(i, prototype[i]);
+		for (uint32_t rank = initial_ones; rank < texels; rank++)
+		{
+			uint32_t void_idx = field.FindExtremum(0, false);
+			field.Set(void_idx, 1);
+			ranks[void_idx] = rank;
+		}
+	}
+
+	void LoadOrGenerateBlueNoise(uint32_t size, uint32_t seed, ThreadPool& pool, std::vector<uint32_t>& ranks)
+	{
+		size = std::clamp(size, 1u, MAX_BLUE_NOISE_SIZE);
+		const std::string path = BlueNoiseCachePath(size, seed);
+		if (ReadBlueNoiseCache(path, size, seed, ranks))
+			return;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		GenerateVoidAndCluster(size, seed, pool, ranks);
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("[Blue Noise] %ux%u seed %u generated in %.2fs on %u workers => %s\n", size, size, seed, seconds, pool.GetThreadCount() + 1, path.c_str());
+		WriteBlueNoiseCache(path, size, seed, ranks);
+	}
+}
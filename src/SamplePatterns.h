@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <random>
+
+class ThreadPool;
+
+//////////////////////////////////////////////////
+// SAMPLE PATTERNS
+//////////////////////////////////////////////////
+//Low discrepancy point sets for the SSAO kernel & a void and cluster blue noise generator for the
+//per pixel kernel rotation. Everything is seeded, same seed => bit identical output (A/B runs).
+constexpr uint32_t MAX_BLUE_NOISE_SIZE = 64; //64^2 rotations fit the frame arena upload
+constexpr const char* BLUE_NOISE_CACHE_DIR = "cache";
+
+namespace SamplePatterns
+{
+	//std distributions & std::shuffle differ between standard libraries, these only rely on mt19937 output
+	float UniformFloat(std::mt19937& rng);
+	//[lo, hi)
+	float UniformFloat(std::mt19937& rng, float lo, float hi);
+	//[0, count)
+	uint32_t UniformIndex(std::mt19937& rng, uint32_t count);
+	//running sums of the weights (last > 0) => index picked proportional to its weight
+	uint32_t WeightedIndex(const std::vector<float>& cumulative_weights, std::mt19937& rng);
+	void Shuffle(std::vector<uint32_t>& values, std::mt19937& rng);
+
+	//van der Corput in base, index 0 => 0
+	float RadicalInverse(uint32_t index, uint32_t base);
+
+	//slot => sequence index such that strided slots (i * 2^k) hold a prefix of the sequence,
+	//the SSAO pass takes strided subsets of the kernel for reduced sample counts
+	void BitReversalOrder(uint32_t count, std::vector<uint32_t>& order);
+
+	//u E [0, 1)^2 => unit vector in the +z hemisphere, uniform over the area or cosine weighted
+	glm::vec3 HemisphereDirection(float u1, float u2, bool cosine_weighted);
+
+	//rank of every texel in a size x size toroidal blue noise mask, ranks E [0, size * size).
+	//Energy updates & extremum searches run across the pool, ties break on the lowest index
+	//so the result does not depend on the thread count.
+	void GenerateVoidAndCluster(uint32_t size, uint32_t seed, ThreadPool& pool, std::vector<uint32_t>& ranks);
+
+	//BLUE_NOISE_CACHE_DIR/blue_noise_<size>_<seed>.bin when present, otherwise generates & writes it
+	void LoadOrGenerateBlueNoise(uint32_t size, uint32_t seed, ThreadPool& pool, std::vector<uint32_t>& ranks);
+}
@@ -0,0 +1,78 @@
+#include "SceneGenerator.h"
+#include "SamplePatterns.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+float ProceduralSceneExtent(const ProceduralSceneDesc& desc)
+{
+	float density = (desc.density > 1e-4f) ? desc.density : 1e-4f;
+	return std::sqrt(static_cast<float>(desc.objectCount) / density);
+}
+
+void GenerateProceduralScene(const ProceduralSceneDesc& desc, std::vector<ProceduralObject>& objects)
+{
+	objects.clear();
+	if (desc.meshSlots.empty() || desc.objectCount == 0)
+		return;
+	objects.reserve(desc.objectCount);
+
+	//std distributions are implementation defined, SamplePatterns helpers => same scene on every toolchain
+	std::mt19937 rng(desc.seed);
+	std::vector<float> cumulative_weights;
+	cumulative_weights.reserve(desc.meshSlots.size());
+	float weight_sum = 0.0f;
+	for (const auto& slot : desc.meshSlots)
+	{
+		weight_sum += std::max(slot.weight, 0.0f);
+		cumulative_weights.push_back(weight_sum);
+	}
+	//all zero => every slot equally likely
+	if (weight_sum <= 0.0f)
+	{
+		for (size_t i = 0; i < cumulative_weights.size(); i++)
+			cumulative_weights[i] = static_cast<float>(i + 1);
+	}
+
+	const float half_extent = 0.5f * ProceduralSceneExtent(desc);
+	//sliders are independent, min > max would flip the range
+	const auto scale_range = std::minmax(desc.minScale, desc.maxScale);
+	const uint32_t material_count = (desc.materialVariety > 0) ? desc.materialVariety : 1;
+
+	//one draw per statement, argument evaluation order is unspecified
+	for (uint32_t i = 0; i < desc.objectCount; i++)
+	{
+		const uint32_t mesh_slot = SamplePatterns::WeightedIndex(cumulative_weights, rng);
+		const auto& slot = desc.meshSlots[mesh_slot];
+		const float scale = SamplePatterns::UniformFloat(rng, scale_range.first, scale_range.second) * slot.baseScale;
+		const float pos_x = SamplePatterns::UniformFloat(rng, -half_extent, half_extent);
+		const float pos_z = SamplePatterns::UniformFloat(rng, -half_extent, half_extent);
+		const float yaw = SamplePatterns::UniformFloat(rng, 0.0f, 360.0f);
+		const uint32_t material_idx = SamplePatterns::UniformIndex(rng, material_count);
+		glm::vec3 position(pos_x, slot.groundOffset * scale / slot.baseScale, pos_z);
+
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), position) *
+			glm::rotate(glm::mat4(1.0f), glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+		objects.push_back({ mesh_slot, material_idx, transform });
+	}
+}
+
+void GenerateProceduralMaterials(const ProceduralSceneDesc& desc, std::vector<ProceduralMaterialData>& materials)
+{
+	materials.clear();
+	materials.reserve(desc.materialVariety);
+
+	//seperate stream from the placement, changing variety doesnt move objects
+	std::mt19937 rng(desc.seed ^ 0x9E3779B9u);
+	for (uint32_t i = 0; i < desc.materialVariety; i++)
+	{
+		glm::vec3 diffuse;
+		for (int c = 0; c < 3; c++)
+			diffuse[c] = SamplePatterns::UniformFloat(rng, 0.05f, 1.0f);
+		const float spec = SamplePatterns::UniformFloat(rng, 0.05f, 1.0f);
+		const float shininess = SamplePatterns::UniformFloat(rng, 4.0f, 128.0f);
+		materials.push_back({ diffuse * 0.4f, diffuse, glm::vec3(spec), shininess });
+	}
+}
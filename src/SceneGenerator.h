@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+//////////////////////////////////////////////////
+// PROCEDURAL SCENE GENERATOR
+//////////////////////////////////////////////////
+//Pure data generation (no GL), same seed + desc => same scene.
+//The program maps the output to GameObjects with its own mesh & material buffers.
+struct ProceduralMeshSlot
+{
+	uint32_t meshIdx = 0;		//index into the program mesh buffer
+	float weight = 1.0f;		//relative spawn probability
+	float baseScale = 1.0f;		//normalises model units
+	float groundOffset = 0.0f;	//lifts the mesh to sit on the floor at scale 1
+};
+
+struct ProceduralSceneDesc
+{
+	uint32_t seed = 1337;
+	uint32_t objectCount = 1000;
+	float density = 0.5f;			//objects per square unit on the floor
+	float minScale = 0.5f;
+	float maxScale = 1.5f;
+	uint32_t materialVariety = 8;	//generated materials, objects pick uniformly
+	std::vector<ProceduralMeshSlot> meshSlots;
+};
+
+struct ProceduralObject
+{
+	uint32_t meshSlot;
+	uint32_t materialIdx;
+	glm::mat4 transform;
+};
+
+struct ProceduralMaterialData
+{
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float shininess;
+};
+
+//floor side length the objects are scattered over
+float ProceduralSceneExtent(const ProceduralSceneDesc& desc);
+void GenerateProceduralScene(const ProceduralSceneDesc& desc, std::vector<ProceduralObject>& objects);
+void GenerateProceduralMaterials(const ProceduralSceneDesc& desc, std::vector<ProceduralMaterialData>& materials);
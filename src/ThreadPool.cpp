@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+{
+	if (thread_count == 0)
+	{
+		uint32_t hw_threads = std::thread::hardware_concurrency();
+		thread_count = (hw_threads > 1) ? hw_threads - 1 : 1;
+	}
+
+	mWorkers.reserve(thread_count);
+	for (uint32_t i = 0; i < thread_count; i++)
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		bStopping = true;
+	}
+	mJobCV.notify_all();
+	for (auto& worker : mWorkers)
+		worker.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(std::move(job));
+	}
+	mJobCV.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdleCV.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+void ThreadPool::RunParallelFor(uint32_t count, ParallelForFn invoke, void* ctx)
+{
+	if (count == 0)
+		return;
+
+	//only one parallel for at a time, nested/concurrent callers queue up here
+	std::lock_guard<std::mutex> for_lock(mParallelForMutex);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mForInvoke = invoke;
+		mForCtx = ctx;
+		mForCount = count;
+		mForNext.store(0);
+		mForDone.store(0);
+		mForGeneration++;
+	}
+	mJobCV.notify_all();
+
+	ParallelForWork(invoke, ctx, count);
+
+	//wait for the work & for every worker to leave, no stale worker may touch the next generation
+	std::unique_lock<std::mutex> lock(mMutex);
+	mForDoneCV.wait(lock, [this, count]() { return mForDone.load() == count && mForActiveWorkers == 0; });
+	mForInvoke = nullptr;
+	mForCtx = nullptr;
+	mForCount = 0;
+}
+
+void ThreadPool::ParallelForWork(ParallelForFn invoke, void* ctx, uint32_t count)
+{
+	while (true)
+	{
+		uint32_t idx = mForNext.fetch_add(1);
+		if (idx >= count)
+			return;
+		invoke(ctx, idx);
+		mForDone.fetch_add(1);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint64_t seen_for_generation = 0;
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobCV.wait(lock, [this, &seen_for_generation]()
+				{
+					return bStopping || !mJobs.empty() || (mForInvoke && mForGeneration != seen_for_generation);
+				});
+
+			if (mForInvoke && mForGeneration != seen_for_generation)
+			{
+				seen_for_generation = mForGeneration;
+				ParallelForFn invoke = mForInvoke;
+				void* ctx = mForCtx;
+				uint32_t count = mForCount;
+				mForActiveWorkers++;
+				lock.unlock();
+
+				ParallelForWork(invoke, ctx, count);
+
+				lock.lock();
+				mForActiveWorkers--;
+				lock.unlock();
+				mForDoneCV.notify_all();
+				continue;
+			}
+
+			//drain remaining jobs before stopping
+			if (mJobs.empty())
+				return;
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+			mActiveJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mActiveJobs--;
+			if (mJobs.empty() && mActiveJobs == 0)
+				mIdleCV.notify_all();
+		}
+	}
+}
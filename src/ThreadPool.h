@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <type_traits>
+
+//////////////////////////////////////////////////
+// THREAD POOL
+//////////////////////////////////////////////////
+//Fixed set of worker threads pulling jobs from a single queue.
+//Jobs must not touch GL, the context only lives on the main thread.
+class ThreadPool
+{
+public:
+	//0 => hardware threads - 1 (main thread keeps rendering), min of 1
+	explicit ThreadPool(uint32_t thread_count = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Enqueue(std::function<void()> job);
+	//blocks till the queue is empty & every worker is idle
+	void WaitIdle();
+
+	//runs fn(i) for i E [0, count) across the workers & the calling thread, returns when all are done.
+	//fn is referenced not copied, no heap allocation per call.
+	template<typename F>
+	void ParallelFor(uint32_t count, F&& fn)
+	{
+		using FnType = std::remove_reference_t<F>;
+		RunParallelFor(count, [](void* ctx, uint32_t idx) { (*static_cast<FnType*>(ctx))(idx); }, const_cast<void*>(static_cast<const void*>(&fn)));
+	}
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+private:
+	using ParallelForFn = void(*)(void*, uint32_t);
+	void RunParallelFor(uint32_t count, ParallelForFn invoke, void* ctx);
+	//grabs indices of the active parallel for till exhausted
+	void ParallelForWork(ParallelForFn invoke, void* ctx, uint32_t count);
+	void WorkerLoop();
+
+	std::vector<std::thread> mWorkers;
+	std::deque<std::function<void()>> mJobs;
+	std::mutex mMutex;
+	std::condition_variable mJobCV;
+	std::condition_variable mIdleCV;
+	uint32_t mActiveJobs = 0;
+	bool bStopping = false;
+
+	//active parallel for (one at a time)
+	std::mutex mParallelForMutex;
+	ParallelForFn mForInvoke = nullptr;
+	void* mForCtx = nullptr;
+	uint32_t mForCount = 0;
+	uint64_t mForGeneration = 0;
+	uint32_t mForActiveWorkers = 0;
+	std::atomic<uint32_t> mForNext{ 0 };
+	std::atomic<uint32_t> mForDone{ 0 };
+	std::condition_variable mForDoneCV;
+};
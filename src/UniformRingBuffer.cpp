@@ -0,0 +1,111 @@
+#include "UniformRingBuffer.h"
+
+#include "pregl/Core/Log.h"
+
+#include <cstring>
+
+void UniformRingBuffer::Generate(size_t region_size, uint32_t frame_count)
+{
+	Release();
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	mAlignment = static_cast<size_t>(alignment > 0 ? alignment : 256);
+	mRegionSize = (region_size + mAlignment - 1) / mAlignment * mAlignment;
+	mFrameCount = (frame_count > MAX_UNIFORM_RING_FRAMES) ? MAX_UNIFORM_RING_FRAMES : ((frame_count > 0) ? frame_count : 1);
+	mCurrRegion = 0;
+	mWriteHead = 0;
+
+	const GLsizeiptr total_size = static_cast<GLsizeiptr>(mRegionSize * mFrameCount);
+	glGenBuffers(1, &mBufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, mBufferID);
+	if (GLEW_ARB_buffer_storage)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, total_size, nullptr, flags);
+		mMappedPtr = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, total_size, flags));
+	}
+	if (!mMappedPtr)
+	{
+		DEBUG_LOG("Persistent map unavailable, uniform ring falls back to glBufferSubData");
+		//storage from glBufferStorage is immutable even when the map failed, glBufferData needs a fresh name
+		if (GLEW_ARB_buffer_storage)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glDeleteBuffers(1, &mBufferID);
+			glGenBuffers(1, &mBufferID);
+			glBindBuffer(GL_UNIFORM_BUFFER, mBufferID);
+		}
+		glBufferData(GL_UNIFORM_BUFFER, total_size, nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRingBuffer::Release()
+{
+	for (auto& fence : mFences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (mBufferID)
+	{
+		if (mMappedPtr)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, mBufferID);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &mBufferID);
+	}
+	mBufferID = 0;
+	mMappedPtr = nullptr;
+}
+
+void UniformRingBuffer::BeginFrame()
+{
+	mWriteHead = 0;
+	GLsync& fence = mFences[mCurrRegion];
+	if (!fence)
+		return;
+
+	//cheap poll first, only count as a stall when we actually block
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		mStallCount++;
+		GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (glClientWaitSync(fence, wait_flags, 1000000) == GL_TIMEOUT_EXPIRED)
+			wait_flags = 0;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void UniformRingBuffer::EndFrame()
+{
+	mFences[mCurrRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mCurrRegion = (mCurrRegion + 1) % mFrameCount;
+}
+
+size_t UniformRingBuffer::Write(const void* data, size_t size)
+{
+	PGL_ASSERT_CRITICAL(mWriteHead + size <= mRegionSize, "Uniform ring region overflow, increase region size");
+	const size_t offset = mCurrRegion * mRegionSize + mWriteHead;
+	if (mMappedPtr)
+		memcpy(mMappedPtr + offset, data, size);
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, mBufferID);
+		glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	mWriteHead += (size + mAlignment - 1) / mAlignment * mAlignment;
+	return offset;
+}
+
+void UniformRingBuffer::BindRange(uint32_t binding, size_t offset, size_t size) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, mBufferID, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// UNIFORM RING BUFFER
+//////////////////////////////////////////////////
+//One uniform buffer split into per frame regions (triple buffered by default).
+//With ARB_buffer_storage the buffer is persistently & coherently mapped, writes are plain memcpy
+//and each region is fenced so the CPU never overwrites data the GPU is still reading.
+//Without it, falls back to glBufferSubData into the same layout.
+constexpr uint32_t MAX_UNIFORM_RING_FRAMES = 4;
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer() = default;
+	~UniformRingBuffer() { Release(); }
+
+	UniformRingBuffer(const UniformRingBuffer&) = delete;
+	UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+	void Generate(size_t region_size, uint32_t frame_count = 3);
+	void Release();
+
+	//waits (if needed) for the GPU to finish with the region about to be reused
+	void BeginFrame();
+	//fences the current region & advances to the next
+	void EndFrame();
+
+	//returns the offset from the buffer start, aligned for binding
+	size_t Write(const void* data, size_t size);
+	template<typename T>
+	size_t Write(const T& data) { return Write(&data, sizeof(T)); }
+	void BindRange(uint32_t binding, size_t offset, size_t size) const;
+
+	bool IsPersistentlyMapped() const { return mMappedPtr != nullptr; }
+	//number of BeginFrame calls that had to block on a fence
+	uint64_t GetStallCount() const { return mStallCount; }
+
+private:
+	GLuint mBufferID = 0;
+	uint8_t* mMappedPtr = nullptr;
+	size_t mRegionSize = 0;
+	size_t mAlignment = 256;
+	uint32_t mFrameCount = 0;
+	uint32_t mCurrRegion = 0;
+	size_t mWriteHead = 0;
+	uint64_t mStallCount = 0;
+	std::array<GLsync, MAX_UNIFORM_RING_FRAMES> mFences{};
+};
+
+
+//////////////////////////////////////////////////
+// PER FRAME UNIFORM BLOCKS (std140)
+//////////////////////////////////////////////////
+constexpr uint32_t CAMERA_UBO_BINDING = 0;
+constexpr uint32_t FRAME_PARAMS_UBO_BINDING = 1;
+
+//uCameraMat
+struct CameraBlock
+{
+	glm::vec3 viewPos;
+	float far;
+	glm::mat4 proj;
+	glm::mat4 view;
+};
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match std140 uCameraMat");
+
+//uFrameParams
+struct FrameParamsBlock
+{
+	glm::mat4 projection;
+	glm::vec4 lightDirection;	//xyz, w => enable
+	glm::vec4 lightDiffuse;
+	glm::vec4 lightSpecular;
+	glm::vec4 aoParams;			//radius, bias, power, resolution scale
+	glm::vec4 noiseScale;		//xy, unused
+	glm::ivec4 aoSettings;		//kernel size, ws sample, sample count, blur radius
+	glm::ivec4 lightingFlags;	//enable ao, blur ao, only ao render, SSAO sample heatmap
+	glm::vec4 clusterParams;	//near, log(far/near), local light count, unused
+	glm::ivec4 clusterSettings;	//grid x, y, z, enable
+};
+static_assert(sizeof(FrameParamsBlock) == 208, "FrameParamsBlock must match std140 uFrameParams");
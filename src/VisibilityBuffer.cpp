@@ -0,0 +1,123 @@
+#include "VisibilityBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void VisibilityBuffer::Generate(uint32_t width, uint32_t height, uint32_t max_materials)
+{
+	Release();
+	mWidth = width;
+	mHeight = height;
+	mMaxMaterials = max_materials;
+	CreateTargets();
+
+	glGenBuffers(1, &mMaterialSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mMaterialSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPUVisMaterial) * mMaxMaterials, nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &mInstanceSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void VisibilityBuffer::Release()
+{
+	ReleaseTargets();
+	GLuint buffers[] = { mMaterialSSBO, mInstanceSSBO };
+	for (GLuint id : buffers)
+	{
+		if (id)
+			glDeleteBuffers(1, &id);
+	}
+	mMaterialSSBO = mInstanceSSBO = 0;
+}
+
+void VisibilityBuffer::Resize(unsigned int width, unsigned int height)
+{
+	if (width == 0 || height == 0 || (width == mWidth && height == mHeight))
+		return;
+	mWidth = width;
+	mHeight = height;
+	ReleaseTargets();
+	CreateTargets();
+}
+
+void VisibilityBuffer::CreateTargets()
+{
+	glGenTextures(1, &mIDTexture);
+	glBindTexture(GL_TEXTURE_2D, mIDTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32UI, mWidth, mHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &mDepthTexture);
+	glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, mWidth, mHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mIDTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		printf("[Visibility Buffer] Framebuffer incomplete\n");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VisibilityBuffer::ReleaseTargets()
+{
+	if (mFBO)
+		glDeleteFramebuffers(1, &mFBO);
+	if (mIDTexture)
+		glDeleteTextures(1, &mIDTexture);
+	if (mDepthTexture)
+		glDeleteTextures(1, &mDepthTexture);
+	mFBO = mIDTexture = mDepthTexture = 0;
+}
+
+void VisibilityBuffer::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	const GLuint clear_ids[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, clear_ids);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VisibilityBuffer::UnBind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VisibilityBuffer::BindTextures(uint32_t id_unit, uint32_t depth_unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + id_unit);
+	glBindTexture(GL_TEXTURE_2D, mIDTexture);
+	glActiveTexture(GL_TEXTURE0 + depth_unit);
+	glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+}
+
+void VisibilityBuffer::BindBuffers() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VIS_MATERIAL_SSBO_BINDING, mMaterialSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VIS_INSTANCE_SSBO_BINDING, mInstanceSSBO);
+}
+
+void VisibilityBuffer::UploadMaterials(const GPUVisMaterial* materials, uint32_t count)
+{
+	count = std::min(count, mMaxMaterials);
+	if (count == 0)
+		return;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mMaterialSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPUVisMaterial) * count, materials);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void VisibilityBuffer::UploadInstanceMaterials(const std::vector<uint32_t>& instance_materials)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t) * std::max<size_t>(instance_materials.size(), 1),
+				 instance_materials.empty() ? nullptr : instance_materials.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "pregl/Renderer/GPUResources.h"
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//////////////////////////////////////////////////
+// VISIBILITY BUFFER
+//////////////////////////////////////////////////
+//Geometry pass writes only (instance id + 1, triangle id) into RG32UI + depth.
+//A fullscreen resolve then rebuilds the G-buffer attributes: position from depth, the normal from
+//neighbouring texels on the same triangle (exact face plane) & material via instance => material SSBOs.
+//Instance ids carry the sub mesh in the top VIS_SUBMESH_BITS so multi mesh objects keep triangles apart.
+constexpr uint32_t VIS_MATERIAL_SSBO_BINDING = 3;
+constexpr uint32_t VIS_INSTANCE_SSBO_BINDING = 4;
+constexpr uint32_t VIS_SUBMESH_BITS = 8;
+constexpr uint32_t VIS_MAX_INSTANCES = (1u << (32 - VIS_SUBMESH_BITS)) - 1;
+
+//std430 MaterialData in VisibilityResolve.frag
+struct GPUVisMaterial
+{
+	glm::vec4 diffuse;
+	glm::vec4 ambient;
+	glm::vec4 specularShininess; //specular rgb, shininess
+};
+static_assert(sizeof(GPUVisMaterial) == 48, "GPUVisMaterial must match std430 MaterialData");
+
+class VisibilityBuffer
+{
+public:
+	VisibilityBuffer() = default;
+	~VisibilityBuffer() { Release(); }
+
+	VisibilityBuffer(const VisibilityBuffer&) = delete;
+	VisibilityBuffer& operator=(const VisibilityBuffer&) = delete;
+
+	void Generate(uint32_t width, uint32_t height, uint32_t max_materials);
+	void Release();
+	void Resize(unsigned int width, unsigned int height);
+
+	//binds & clears ids to 0 (empty) & depth to 1
+	void Bind();
+	void UnBind();
+	//usampler2D ids & sampler2D depth for the resolve
+	void BindTextures(uint32_t id_unit, uint32_t depth_unit) const;
+	void BindBuffers() const;
+
+	//small, every frame so material edits show up
+	void UploadMaterials(const GPUVisMaterial* materials, uint32_t count);
+	//instance => material table index, only when the scene changes
+	void UploadInstanceMaterials(const std::vector<uint32_t>& instance_materials);
+
+private:
+	void CreateTargets();
+	void ReleaseTargets();
+
+	GLuint mFBO = 0;
+	GLuint mIDTexture = 0;
+	GLuint mDepthTexture = 0;
+	GLuint mMaterialSSBO = 0;
+	GLuint mInstanceSSBO = 0;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mMaxMaterials = 0;
+};
@@ -8,7 +8,10 @@
 
 #include "SSAOProgram.h"
 
-int main()
+#include <cstring>
+#include <cstdlib>
+
+int main(int argc, char** argv)
 {
 	//SCOPE_MEM_ALLOC_PROFILE("Program");
 //OPEN_BLOCK_MEM_TRACKING_PROFILE(Program);
@@ -21,6 +24,111 @@ int main()
 	auto gfx = new SSAOProgram();
 	gfx->OnInitialise(&app.GetWindow());
 	gfx->SetCamera(&app.GetCamera());
+
+	//--alloc-check [warmup frames] [test frames] => headless run, exit code reports steady state allocations
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--alloc-check") == 0)
+		{
+			uint32_t warmup_frames = (i + 1 < argc) ? static_cast<uint32_t>(atoi(argv[i + 1])) : 120;
+			uint32_t test_frames = (i + 2 < argc) ? static_cast<uint32_t>(atoi(argv[i + 2])) : 600;
+			bool passed = gfx->RunSteadyStateAllocationCheck(warmup_frames, test_frames);
+			gfx->OnDestroy();
+			delete gfx;
+			return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		//--ao-batch <pose file> <output dir> => render & write AO for every pose
+		if (strcmp(argv[i], "--ao-batch") == 0 && i + 2 < argc)
+		{
+			std::vector<AOBatchPose> poses;
+			bool passed = LoadAOBatchPoses(argv[i + 1], poses);
+			if (passed)
+				passed = gfx->RunAOBatch(poses, argv[i + 2]).failedReadbacks == 0;
+			gfx->OnDestroy();
+			delete gfx;
+			return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		//--scene-bench [csv path] => procedural scene scaling benchmark
+		if (strcmp(argv[i], "--scene-bench") == 0)
+		{
+			gfx->RunSceneScalingBenchmark((i + 1 < argc) ? argv[i + 1] : nullptr);
+			gfx->OnDestroy();
+			delete gfx;
+			return EXIT_SUCCESS;
+		}
+
+		//--light-bench [csv path] => clustered lighting at 16, 256 & 4096 local lights
+		if (strcmp(argv[i], "--light-bench") == 0)
+		{
+			gfx->RunLightingBenchmark((i + 1 < argc) ? argv[i + 1] : nullptr);
+			gfx->OnDestroy();
+			delete gfx;
+			return EXIT_SUCCESS;
+		}
+
+		//--kernel-ab [csv path] => AO error of each kernel pattern & noise type at 64, 32 & 16 taps
+		if (strcmp(argv[i], "--kernel-ab") == 0)
+		{
+			gfx->RunKernelPatternComparison((i + 1 < argc) ? argv[i + 1] : nullptr);
+			gfx->OnDestroy();
+			delete gfx;
+			return EXIT_SUCCESS;
+		}
+
+		//--governor-test [csv path] => quality governor under a synthetic load step, exit code reports convergence
+		if (strcmp(argv[i], "--governor-test") == 0)
+		{
+			bool passed = gfx->RunQualityGovernorTest((i + 1 < argc) ? argv[i + 1] : nullptr);
+			gfx->OnDestroy();
+			delete gfx;
+			return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		//--gbuffer-mode <direct|prepass|visibility> => applies to the run & any benchmark after it
+		if (strcmp(argv[i], "--gbuffer-mode") == 0 && i + 1 < argc)
+		{
+			if (strcmp(argv[i + 1], "prepass") == 0)
+				gfx->SetGBufferMode(EGBufferMode::DEPTH_PREPASS);
+			else if (strcmp(argv[i + 1], "visibility") == 0)
+			{
+				gfx->SetGBufferMode(EGBufferMode::VISIBILITY_BUFFER);
+				DEBUG_LOG("Visibility G-buffer resolves flat face normals, AO & lighting are an approximation of direct");
+			}
+			else
+				gfx->SetGBufferMode(EGBufferMode::DIRECT);
+		}
+
+		//--procedural-scene <object count> [seed] => launch with a generated scene
+		if (strcmp(argv[i], "--procedural-scene") == 0 && i + 1 < argc)
+		{
+			ProceduralSceneDesc desc = gfx->GetProceduralSceneDesc();
+			desc.objectCount = static_cast<uint32_t>(atoi(argv[i + 1]));
+			//optional seed, only a whole number that is not the next flag
+			if (i + 2 < argc && strncmp(argv[i + 2], "--", 2) != 0)
+			{
+				char* end = nullptr;
+				unsigned long seed = strtoul(argv[i + 2], &end, 10);
+				if (end != argv[i + 2] && *end == '\0')
+					desc.seed = static_cast<uint32_t>(seed);
+				else
+					DEBUG_LOG("--procedural-scene seed is not a number, keeping the default");
+			}
+			gfx->LoadProceduralScene(desc);
+		}
+
+		//--ao-batch-bench [view count]
+		if (strcmp(argv[i], "--ao-batch-bench") == 0)
+		{
+			uint32_t view_count = (i + 1 < argc) ? static_cast<uint32_t>(atoi(argv[i + 1])) : 256;
+			gfx->RunAOBatchBenchmark(view_count);
+			gfx->OnDestroy();
+			delete gfx;
+			return EXIT_SUCCESS;
+		}
+	}
+
 	app.AddGfxProgram(gfx);
 
 	app.Run();